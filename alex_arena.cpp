@@ -0,0 +1,80 @@
+#include "alex_arena.h"
+
+Arena::~Arena() {
+	while (fBlocks) {
+		Block* next = fBlocks->next;
+		free(fBlocks);
+		fBlocks = next;
+	}
+	free(fSpare);
+}
+
+void* Arena::allocSlow(size_t bytes, size_t align) {
+	// room for the header, the request and worst case alignment padding
+	size_t need = sizeof(Block) + bytes + align;
+	Block* block;
+	size_t size;
+	if (fSpare && fSpare->size >= need) {
+		block = fSpare;
+		size = block->size;
+		fSpare = nullptr;
+	} else {
+		size = std::max(fNextBlockSize, need);
+		block = (Block*)malloc(size);
+		// callers use the memory unchecked, so fail the way operator new does
+		if (!block)
+			throw std::bad_alloc();
+		block->size = size;
+		fCapacity += size;
+		fNextBlockSize = size * 2;
+	}
+	block->next = fBlocks;
+	fBlocks = block;
+
+	fCursor = (char*)(block + 1);
+	fEnd = (char*)block + size;
+	return this->alloc(bytes, align);
+}
+
+void Arena::rewind(const Mark& mark) {
+	while (fBlocks != mark.block) {
+		Block* next = fBlocks->next;
+		// grow from the oldest released block again, or repeated save/restore cycles would
+		// double the block size every time
+		fNextBlockSize = fBlocks->size;
+		this->release(fBlocks);
+		fBlocks = next;
+	}
+	fCursor = mark.cursor;
+	fEnd = fBlocks ? (char*)fBlocks + fBlocks->size : nullptr;
+}
+
+void Arena::release(Block* block) {
+	if (fSpare && fSpare->size >= block->size) {
+		fCapacity -= block->size;
+		free(block);
+		return;
+	}
+	if (fSpare) {
+		fCapacity -= fSpare->size;
+		free(fSpare);
+	}
+	fSpare = block;
+}
+
+void Arena::reset() {
+	if (!fBlocks)
+		return;
+	// free every block but the newest, which is also the largest
+	Block* keep = fBlocks;
+	Block* b = keep->next;
+	while (b) {
+		Block* next = b->next;
+		fCapacity -= b->size;
+		free(b);
+		b = next;
+	}
+	keep->next = nullptr;
+	fCursor = (char*)(keep + 1);
+	fEnd = (char*)keep + keep->size;
+}
@@ -0,0 +1,116 @@
+#ifndef alex_arena_DEFINED
+#define alex_arena_DEFINED
+
+#include "include/GTypes.h"
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <utility>
+
+/*
+ *  Bump-pointer allocator. Memory is handed out from large blocks and only released in bulk
+ *  by reset() or the destructor. reset() keeps the newest (largest) block, so a workload that
+ *  repeats the same allocations stops calling malloc after the first pass.
+ */
+class Arena {
+public:
+	Arena(size_t firstBlockSize = 4096) : fNextBlockSize(firstBlockSize) {}
+	~Arena();
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	// Never returns null: like operator new, throws std::bad_alloc when out of memory.
+	void* alloc(size_t bytes, size_t align = alignof(std::max_align_t)) {
+		uintptr_t p = ((uintptr_t)fCursor + align - 1) & ~(uintptr_t)(align - 1);
+		if (fCursor == nullptr || p + bytes > (uintptr_t)fEnd)
+			return this->allocSlow(bytes, align);
+		fCursor = (char*)(p + bytes);
+		return (void*)p;
+	}
+
+	// uninitialized storage for count Ts
+	template <typename T> T* makeArray(size_t count, size_t align = alignof(T)) {
+		return (T*)this->alloc(count * sizeof(T), align);
+	}
+
+	// Construct a T in the arena. Its destructor is never run, so T must not own anything.
+	template <typename T, typename... Args> T* make(Args&&... args) {
+		return new (this->alloc(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+	}
+
+	// release everything, keeping the newest block for reuse
+	void reset();
+
+	// Allocation position for stack-like use: rewind() releases everything allocated since
+	// the mark was taken, including any blocks added after it. The largest released block is
+	// kept for the next block the arena needs, so a mark/rewind loop whose allocations spill
+	// past the current block does not call malloc every time round.
+	struct Mark {
+		void* block;
+		char* cursor;
+	};
+	Mark mark() const { return {fBlocks, fCursor}; }
+	void rewind(const Mark&);
+
+	// total bytes of blocks owned by the arena, including a spare one
+	size_t capacity() const { return fCapacity; }
+
+private:
+	struct Block {
+		Block* next;
+		size_t size;
+	};
+
+	Block* fBlocks = nullptr;	// newest first
+	Block* fSpare = nullptr;	// released by rewind(), not yet reused
+	char* fCursor = nullptr;
+	char* fEnd = nullptr;
+	size_t fNextBlockSize;
+	size_t fCapacity = 0;
+
+	void* allocSlow(size_t bytes, size_t align);
+	void release(Block*);
+};
+
+/*
+ *  Growable array of plain Ts stored in an arena. Outgrown storage stays in the arena until
+ *  it is reset, so the array must not outlive it.
+ */
+template <typename T> class ArenaArray {
+public:
+	ArenaArray(Arena* arena, int capacity = 0) : fArena(arena) {
+		if (capacity > 0) {
+			fData = fArena->makeArray<T>(capacity);
+			fCapacity = capacity;
+		}
+	}
+
+	void push_back(const T& value) {
+		if (fCount == fCapacity)
+			this->grow();
+		fData[fCount++] = value;
+	}
+
+	int size() const { return fCount; }
+	T* begin() { return fData; }
+	T* end() { return fData + fCount; }
+	T& operator[](int i) { return fData[i]; }
+
+private:
+	Arena* fArena;
+	T* fData = nullptr;
+	int fCount = 0;
+	int fCapacity = 0;
+
+	void grow() {
+		int capacity = fCapacity < 16 ? 32 : fCapacity * 2;
+		T* data = fArena->makeArray<T>(capacity);
+		if (fCount > 0)
+			memcpy(data, fData, fCount * sizeof(T));
+		fData = data;
+		fCapacity = capacity;
+	}
+};
+
+#endif
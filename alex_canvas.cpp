@@ -9,230 +9,344 @@
 #include "alex_matrix_helpers.h"
 #include "alex_tree_shader.h"
 #include "alex_curve.h"
-#include <list>
 #include "alex_tri_color_shader.h"
 #include "alex_proxy_shader.h"
 #include "alex_double_shader.h"
+#include <climits>
+
+/*
+ *  Times a GCanvas call into the canvas's trace, when it has one. While it lives, *current is
+ *  the call's event, for the blitter to add the pixels it writes to. A call made from inside
+ *  another is part of the outer one's event.
+ */
+class TraceScope {
+public:
+	TraceScope(CanvasTrace* trace, CanvasTrace::Event** current, const char name[]) {
+		if (trace && !*current) {
+			*current = trace->begin(name);
+			fCurrent = current;
+		}
+	}
+
+	~TraceScope() {
+		if (fCurrent) {
+			(*fCurrent)->end = GTime::GetNSec();
+			*fCurrent = nullptr;
+		}
+	}
+
+private:
+	CanvasTrace::Event** fCurrent = nullptr;
+};
 
 // Move loop termination into local variable
 inline void MyCanvas::clear(const GColor& color) {
+	TraceScope trace(fTrace, &fTraceEvent, "clear");
 	// scale color
 	unsigned alpha = GRoundToInt(color.a * 255.0f);
-	int width = fDevice.width();
-	int height = fDevice.height();
-	GPixel *row_addr = nullptr;
-	if (alpha == 0) {
-		for (int y=0; y<height; y++) {
-			row_addr = fDevice.getAddr(0, y);
-			clearRow(row_addr, width);
-		}
-	} else {
+	GPixel pixel_color = 0;
+	if (alpha != 0) {
 		unsigned red = GRoundToInt(color.a * color.r * 255.0f);
 		unsigned green = GRoundToInt(color.a * color.g * 255.0f);
 		unsigned blue = GRoundToInt(color.a * color.b * 255.0f);
-		GPixel pixel_color = GPixel_PackARGB(alpha, red, green, blue);
-		for (int y=0; y<height; y++) {
-			row_addr = fDevice.getAddr(0, y);
-			storeRow(row_addr, width, pixel_color);
+		pixel_color = GPixel_PackARGB(alpha, red, green, blue);
+	}
+	auto fill = [&](int y, int left, int right) {
+		GPixel *row_addr = fDevice.getAddr(left, y);
+		if (alpha == 0)
+			clearRow(row_addr, right - left);
+		else
+			storeRow(row_addr, right - left, pixel_color);
+	};
+
+	if (fStats)
+		fStats->draws.clear++;
+	for (const RegionRun& run : fClip) {
+		int top = std::max(run.top, fTile.top);
+		int bottom = std::min(run.bottom, fTile.bottom);
+		int left = std::max(run.left, fTile.left);
+		int right = std::min(run.right, fTile.right);
+		if (left >= right)
+			continue;
+		for (int y=top; y<bottom; y++)
+			fill(y, left, right);
+		for (int y=top; fOverdraw && y<bottom; y++)
+			fOverdraw->addRow(y, left, right);
+		if (top >= bottom)
+			continue;
+		if (fStats)
+			fStats->clearedPixels += (uint64_t)(bottom - top) * (right - left);
+		if (fTraceEvent) {
+			GIRect r = GIRect::LTRB(left, top, right, bottom);
+			fTraceEvent->bounds = fTraceEvent->pixels ? unionIRects(fTraceEvent->bounds, r) : r;
+			fTraceEvent->pixels += (uint64_t)(bottom - top) * (right - left);
 		}
 	}
 }
 
-void MyCanvas::drawRect(const GRect& rect, const GPaint& paint) {
-	if (!isIdentity(ctm)) {
-		const GPoint points[] = { {rect.left, rect.top}, {rect.right, rect.top}, {rect.right, rect.bottom}, {rect.left, rect.bottom} };
-		drawConvexPolygon(points, 4, paint);
-		return;
+/*
+ *  Consumer side of the rasterizer: blits spans with a paint, either a solid color through
+ *  a BlitRowProc or shaded rows through a BlitRowSRProc.
+ */
+class SpanBlitter {
+public:
+	// Spans passed in must lie inside the clip bounds; a complex clip is applied per span.
+	// Only pixels inside tile are written.
+	// What it blits is counted into stats, event and overdraw, where they are not null.
+	SpanBlitter(const CanvasDevice& device, Arena& arena, const GRegion& clip, const GIRect& tile,
+				CanvasStats* stats, CanvasTrace::Event* event, OverdrawMap* overdraw)
+		: fDevice(device), fArena(arena), fClip(clip.isRect() ? nullptr : &clip), fTile(tile),
+		  fStats(stats), fEvent(event), fOverdraw(overdraw), fCounting(stats || event) {}
+
+	~SpanBlitter() {
+		if (fCounts.spans == 0)
+			return;
+		if (fStats) {
+			fStats->spans[(int)fMode] += fCounts.spans;
+			fStats->pixels[(int)fMode] += fCounts.pixels;
+			if (fShaderCounts) {
+				fShaderCounts->shadeRows += fCounts.spans;
+				fShaderCounts->pixels += fCounts.shaded;
+			}
+		}
+		if (fEvent) {
+			// meshes blit a triangle at a time into one event
+			fEvent->bounds = fEvent->pixels ? unionIRects(fEvent->bounds, fCounts.bounds) : fCounts.bounds;
+			fEvent->pixels += fCounts.pixels;
+			fEvent->mode = (int)fMode;
+			if (fShader && !fEvent->shader)
+				fEvent->shader = &typeid(*fShader);
+		}
 	}
 
-	GBlendMode blendMode = paint.getBlendMode();
-	if (blendMode == GBlendMode::kDst)
-		return;
+	// Returns false if drawing with paint would leave the device unchanged.
+	bool setup(const GPaint& paint, const GMatrix& ctm) {
+		GBlendMode blendMode = paint.getBlendMode();
+		if (blendMode == GBlendMode::kDst)
+			return false;
+
+		// check if Paint is using color or ptr to shader for src
+		fShader = paint.peekShader();
+		if (fShader != nullptr) {
+			if (!(fShader->setContext(ctm)))
+				return false;
+			if (fShader->isOpaque())
+				blendMode = optimizeOpaqueBlendMode(blendMode);
+			this->countMode(paint.getBlendMode(), blendMode);
+			if (blendMode == GBlendMode::kDst)
+				return false;
+			if (fStats) {
+				fShaderCounts = fStats->shaderCounts(*fShader);
+				fShaderCounts->draws++;
+			}
+			fBlitRowSR = gblitRowSRProcs[(int) blendMode];
+			fSrcRow = fArena.makeArray<GPixel>(fDevice.width());
+		} else {
+			fSrc = makePixelFromPaint(paint);
+			// optimize blend mode
+			blendMode = optimizeBlendMode(blendMode, fSrc);
+			this->countMode(paint.getBlendMode(), blendMode);
+			if (blendMode == GBlendMode::kDst)
+				return false;
+			fBlitRow = gblitRowProcs[(int) blendMode];
+		}
+		fMode = blendMode;
+		return true;
+	}
+
+	void blit(int y, int left, int right) {
+		this->blit(y, left, right, fSrcRow, fCounting ? &fCounts : nullptr);
+	}
 
-	// src color
-	GPixel src;
+	// With a pool, rows are split into bands blitted concurrently; each shades into its own row.
+	void blitSpans(const SpanList& spans, ThreadPool* pool = nullptr) {
+		// skip the per-span region lookup when the clip covers every span
+		const GRegion* clip = fClip;
+		if (clip && clip->contains(spans.bounds()))
+			fClip = nullptr;
+		if (pool && pool->workerCount() > 0 && spans.count() >= 2 * kMinBandSpans) {
+			int count = spans.count();
+			int bands = std::min(count / kMinBandSpans, 4 * pool->concurrency());
+			size_t width = fDevice.width();
+			GPixel* rows = fShader ? fArena.makeArray<GPixel>(bands * width) : nullptr;
+			// each band counts on its own, summed once they are done
+			Counts* bandCounts = nullptr;
+			if (fCounting) {
+				bandCounts = fArena.makeArray<Counts>(bands);
+				std::fill(bandCounts, bandCounts + bands, Counts());
+			}
+			pool->parallelFor(bands, [&](int band) {
+				GPixel* srcRow = rows ? rows + band * width : nullptr;
+				Counts* counts = bandCounts ? bandCounts + band : nullptr;
+				int lo = (int)((int64_t)count * band / bands);
+				int hi = (int)((int64_t)count * (band + 1) / bands);
+				for (int i=lo; i<hi; i++)
+					this->blit(spans[i].y, spans[i].left, spans[i].right, srcRow, counts);
+			});
+			for (int i=0; bandCounts && i<bands; i++)
+				fCounts.add(bandCounts[i]);
+		} else {
+			Counts* counts = fCounting ? &fCounts : nullptr;
+			spans.replay([this, counts](int y, int left, int right) {
+				this->blit(y, left, right, fSrcRow, counts);
+			});
+		}
+		fClip = clip;
+	}
 
-	// check if Paint is using color or ptr to shader for src
-	bool usingShader = false;
-	GShader *sh = paint.peekShader();
-	if (sh != nullptr) {
-		if (!(sh->setContext(ctm)))
+private:
+	const CanvasDevice& fDevice;
+	Arena& fArena;
+	const GRegion* fClip;
+	GIRect fTile;
+	GShader* fShader = nullptr;
+	GPixel fSrc = 0;
+	GPixel* fSrcRow = nullptr;
+	BlitRowProc fBlitRow = nullptr;
+	BlitRowSRProc fBlitRowSR = nullptr;
+
+	// rows blitted by this draw, added to fStats and fEvent when it is done
+	struct Counts {
+		uint64_t spans = 0;
+		uint64_t pixels = 0;
+		uint64_t shaded = 0;
+		GIRect bounds = GIRect::LTRB(INT_MAX, INT_MAX, INT_MIN, INT_MIN);
+
+		void add(const Counts& c) {
+			spans += c.spans;
+			pixels += c.pixels;
+			shaded += c.shaded;
+			bounds = unionIRects(bounds, c.bounds);
+		}
+	};
+	CanvasStats* fStats;
+	CanvasTrace::Event* fEvent;
+	OverdrawMap* fOverdraw;
+	bool fCounting;
+	CanvasStats::ShaderCounts* fShaderCounts = nullptr;
+	GBlendMode fMode = GBlendMode::kDst;
+	Counts fCounts;
+
+	// fewest spans worth handing to another thread
+	static constexpr int kMinBandSpans = 64;
+
+	void countMode(GBlendMode from, GBlendMode to) {
+		if (fStats && from != to)
+			fStats->downgrades[(int)from][(int)to]++;
+	}
+
+	// counts is null when neither stats nor a trace are on
+	void blit(int y, int left, int right, GPixel srcRow[], Counts* counts) {
+		if (y < fTile.top || y >= fTile.bottom)
 			return;
-		usingShader = true;
-	} else {
-		src = makePixelFromPaint(paint);
-		// optimize blend mode
-		blendMode = optimizeBlendMode(blendMode, src);
-		if (blendMode == GBlendMode::kDst)
+		if (fClip) {
+			fClip->clipSpan(y, left, right, [this, srcRow, counts](int y, int L, int R) {
+				this->blitRow(y, L, R, srcRow, counts);
+			});
+		} else {
+			this->blitRow(y, left, right, srcRow, counts);
+		}
+	}
+
+	void blitRow(int y, int left, int right, GPixel srcRow[], Counts* counts) {
+		int L = std::max(left, fTile.left);
+		int R = std::min(right, fTile.right);
+		if (L >= R)
 			return;
+		if (counts) {
+			counts->spans++;
+			counts->pixels += R - L;
+			counts->shaded += fShader ? R - left : 0;
+			counts->bounds = unionIRects(counts->bounds, GIRect::LTRB(L, y, R, y + 1));
+		}
+		// bands never share pixels, so they can count into the map at once
+		if (fOverdraw)
+			fOverdraw->addRow(y, L, R);
+		GPixel *row_addr = fDevice.getAddr(L, y);
+		if (fShader) {
+			// shaders step along the row, so a span cut by the tile is still shaded from its
+			// own left edge to give the same pixels as an untiled canvas
+			fShader->shadeRow(left, y, R - left, srcRow);
+			fBlitRowSR(row_addr, R - L, srcRow + (L - left));
+		} else {
+			fBlitRow(row_addr, R - L, fSrc);
+		}
 	}
-	int iWidth = fDevice.width();
-	float width = (float) iWidth;
-	float height = (float) fDevice.height();
-	int top = GRoundToInt(std::min(std::max(rect.top, 0.0f), height));
-	int bottom = GRoundToInt(std::min(std::max(rect.bottom, 0.0f), height));
-	int left = GRoundToInt(std::min(std::max(rect.left, 0.0f), width));
-	int right = GRoundToInt(std::min(std::max(rect.right, 0.0f), width));
+};
+
+// A shader built in the canvas arena, in a GPaint that must not outlive the draw.
+static std::shared_ptr<GShader> borrowShader(GShader* shader) {
+	// aliasing an empty owner: nothing is counted or deleted
+	return std::shared_ptr<GShader>(std::shared_ptr<GShader>(), shader);
+}
+
+static void rectToSpans(const GRect& rect, const GIRect& clip, SpanList* spans) {
+	int top = std::min(std::max(GRoundToInt(rect.top), clip.top), clip.bottom);
+	int bottom = std::min(std::max(GRoundToInt(rect.bottom), clip.top), clip.bottom);
+	int left = std::min(std::max(GRoundToInt(rect.left), clip.left), clip.right);
+	int right = std::min(std::max(GRoundToInt(rect.right), clip.left), clip.right);
 	if (left >= right || top >= bottom)
 		return;
-	int range = right - left;
-	GPixel *row_addr = nullptr;
-	if (usingShader) {
-		if (sh->isOpaque())
-			blendMode = optimizeOpaqueBlendMode(blendMode);
-		GPixel srcRow[iWidth];
-		switch (blendMode) {
-			case GBlendMode::kClear:
-				for (int y=top; y<bottom; y++) {
-					row_addr = fDevice.getAddr(left, y);
-					clearRow(row_addr, range);
-				}
-				break;
-			case GBlendMode::kSrc:
-				for (int y=top; y<bottom; y++) {
-					row_addr = fDevice.getAddr(left, y);
-					sh->shadeRow(left, y, range, srcRow);
-					storeRowSR(row_addr, range, srcRow);	
-				}
-				break;
-			case GBlendMode::kSrcOver:
-				for (int y=top; y<bottom; y++) {
-					row_addr = fDevice.getAddr(left, y);
-					sh->shadeRow(left, y, range, srcRow);
-					blitSrcOverSR(row_addr, range, srcRow);
-				}
-				break;
-			case GBlendMode::kDstOver:
-				for (int y=top; y<bottom; y++) {
-					row_addr = fDevice.getAddr(left, y);
-					sh->shadeRow(left, y, range, srcRow);
-					blitDstOverSR(row_addr, range, srcRow);
-				}
-				break;	
-			case GBlendMode::kSrcIn:
-				for (int y=top; y<bottom; y++) {
-					row_addr = fDevice.getAddr(left, y);
-					sh->shadeRow(left, y, range, srcRow);
-					blitSrcInSR(row_addr, range, srcRow);
-				}
-				break;
-			case GBlendMode::kDstIn:
-				for (int y=top; y<bottom; y++) {
-					row_addr = fDevice.getAddr(left, y);
-					sh->shadeRow(left, y, range, srcRow);
-					blitDstInSR(row_addr, range, srcRow);
-				}
-				break;
-			case GBlendMode::kSrcOut:
-				for (int y=top; y<bottom; y++) {
-					row_addr = fDevice.getAddr(left, y);
-					sh->shadeRow(left, y, range, srcRow);
-					blitSrcOutSR(row_addr, range, srcRow);
-				}
-				break;
-			case GBlendMode::kDstOut:
-				for (int y=top; y<bottom; y++) {
-					row_addr = fDevice.getAddr(left, y);
-					sh->shadeRow(left, y, range, srcRow);
-					blitDstOutSR(row_addr, range, srcRow);
-				}
-				break;
-			case GBlendMode::kSrcATop:
-				for (int y=top; y<bottom; y++) {
-					row_addr = fDevice.getAddr(left, y);
-					sh->shadeRow(left, y, range, srcRow);
-					blitSrcATopSR(row_addr, range, srcRow);
-				}
-				break;
-			case GBlendMode::kDstATop:
-				for (int y=top; y<bottom; y++) {
-					row_addr = fDevice.getAddr(left, y);
-					sh->shadeRow(left, y, range, srcRow);
-					blitDstATopSR(row_addr, range, srcRow);
-				}
-				break;
-			case GBlendMode::kXor:
-				for (int y=top; y<bottom; y++) {
-					row_addr = fDevice.getAddr(left, y);
-					sh->shadeRow(left, y, range, srcRow);
-					blitXorBlendSR(row_addr, range, srcRow);
-				}
-				break;
-			default:
-				break;
-		}
-	} else {
-		switch (blendMode) {
-			case GBlendMode::kClear:
-				for (int y=top; y<bottom; y++) {
-					row_addr = fDevice.getAddr(left, y);
-					clearRow(row_addr, range);
-				}
-				break;
-			case GBlendMode::kSrc:
-				for (int y=top; y<bottom; y++) {
-					row_addr = fDevice.getAddr(left, y);
-					storeRow(row_addr, range, src);
-				}
-				break;
-			case GBlendMode::kSrcOver:
-				for (int y=top; y<bottom; y++) {
-					row_addr = fDevice.getAddr(left, y);
-					blitSrcOver(row_addr, range, src);
-				}
-				break;
-			case GBlendMode::kDstOver:
-				for (int y=top; y<bottom; y++) {
-					row_addr = fDevice.getAddr(left, y);
-					blitDstOver(row_addr, range, src);
-				}
-				break;	
-			case GBlendMode::kSrcIn:
-				for (int y=top; y<bottom; y++) {
-					row_addr = fDevice.getAddr(left, y);
-					blitSrcIn(row_addr, range, src);
-				}
-				break;
-			case GBlendMode::kDstIn:
-				for (int y=top; y<bottom; y++) {
-					row_addr = fDevice.getAddr(left, y);
-					blitDstIn(row_addr, range, src);
-				}
-				break;
-			case GBlendMode::kSrcOut:
-				for (int y=top; y<bottom; y++) {
-					row_addr = fDevice.getAddr(left, y);
-					blitSrcOut(row_addr, range, src);
-				}
-				break;
-			case GBlendMode::kDstOut:
-				for (int y=top; y<bottom; y++) {
-					row_addr = fDevice.getAddr(left, y);
-					blitDstOut(row_addr, range, src);
-				}
-				break;
-			case GBlendMode::kSrcATop:
-				for (int y=top; y<bottom; y++) {
-					row_addr = fDevice.getAddr(left, y);
-					blitSrcATop(row_addr, range, src);
-				}
-				break;
-			case GBlendMode::kDstATop:
-				for (int y=top; y<bottom; y++) {
-					row_addr = fDevice.getAddr(left, y);
-					blitDstATop(row_addr, range, src);
-				}
-				break;
-			case GBlendMode::kXor:
-				for (int y=top; y<bottom; y++) {
-					row_addr = fDevice.getAddr(left, y);
-					blitXorBlend(row_addr, range, src);
-				}
-				break;
-			default:
-				break;
-		}
+	for (int y=top; y<bottom; y++)
+		spans->add(y, left, right);
+}
+
+void MyCanvas::rasterizeRect(const GRect& rect, SpanList* spans) {
+	if (!ctm.isScaleTranslate()) {
+		const GPoint points[] = { {rect.left, rect.top}, {rect.right, rect.top}, {rect.right, rect.bottom}, {rect.left, rect.bottom} };
+		rasterizeConvexPolygon(points, 4, spans);
+		return;
 	}
+	// the rect stays axis aligned, so its edges round straight to device pixels exactly as
+	// the polygon rasterizer would round them
+	rectToSpans(ctm.isIdentity() ? rect : mapAxisAlignedRect(ctm, rect), fClip.bounds(), spans);
+}
+
+void MyCanvas::drawRect(const GRect& rect, const GPaint& paint) {
+	TraceScope trace(fTrace, &fTraceEvent, "drawRect");
+	if (fStats)
+		fStats->draws.rect++;
+	fArena.reset();
+	if (!ctm.isScaleTranslate()) {
+		const GPoint points[] = { {rect.left, rect.top}, {rect.right, rect.top}, {rect.right, rect.bottom}, {rect.left, rect.bottom} };
+		this->fillConvexPolygon(points, 4, paint, this->bandPool());
+		return;
+	}
+	SpanList spans(&fArena);
+	rasterizeRect(rect, &spans);
+	if (spans.isEmpty())
+		return;
+	SpanBlitter blitter(fDevice, fArena, fClip, fTile, fStats, fTraceEvent, fOverdraw);
+	if (!blitter.setup(paint, ctm))
+		return;
+	blitter.blitSpans(spans, this->bandPool());
+}
+
+void MyCanvas::drawSpans(const SpanList& spans, const GPaint& paint) {
+	TraceScope trace(fTrace, &fTraceEvent, "drawSpans");
+	if (fStats)
+		fStats->draws.spans++;
+	// only the rows this canvas can write; spans are sorted by y
+	const GIRect& clip = fClip.bounds();
+	auto above = [](const Span& s, int y) { return s.y < y; };
+	const Span* first = std::lower_bound(spans.begin(), spans.end(), std::max(clip.top, fTile.top), above);
+	const Span* last = std::lower_bound(first, spans.end(), std::min(clip.bottom, fTile.bottom), above);
+	if (first == last)
+		return;
+
+	fArena.reset();
+	SpanBlitter blitter(fDevice, fArena, fClip, fTile, fStats, fTraceEvent, fOverdraw);
+	if (!blitter.setup(paint, ctm))
+		return;
+	// spans from elsewhere may reach past the clip
+	SpanList clipped(&fArena);
+	for (const Span* s = first; s < last; s++) {
+		int L = std::max(s->left, clip.left);
+		int R = std::min(s->right, clip.right);
+		if (L < R)
+			clipped.add(s->y, L, R);
+	}
+	blitter.blitSpans(clipped, this->bandPool());
 }
 
 /*
@@ -264,16 +378,16 @@ inline void swapPoints(GPoint& p0, GPoint& p1) {
 	p0 = temp;
 }
 
-inline void lineToEdges(std::vector<Edge>& edges, GPoint p0, GPoint p1, int height, int width) {
+inline void lineToEdges(ArenaArray<Edge>& edges, GPoint p0, GPoint p1, const GIRect& clip) {
 	// swap so that p1 is below
 	if (p0.y > p1.y)
 		swapPoints(p0, p1);
 
 	// skip if both above
-	if (p1.y < 0)
+	if (p1.y < clip.top)
 		return;
 	// skip if both below
-	if (p0.y > height)
+	if (p0.y > clip.bottom)
 		return;
 
 	// check for horizontal lines
@@ -289,15 +403,15 @@ inline void lineToEdges(std::vector<Edge>& edges, GPoint p0, GPoint p1, int heig
 	float b = p0.x - p0.y * mx;
 
 	// straddle top
-	if (p0.y < 0) {
-		p0.x = clipAboveBelow(p0, mx, 0);
-		p0.y = 0;
+	if (p0.y < clip.top) {
+		p0.x = clipAboveBelow(p0, mx, clip.top);
+		p0.y = clip.top;
 	}
 
 	// straddle bottom
-	if (p1.y > height) {
-		p1.x = clipAboveBelow(p1, mx, height);
-		p1.y = height;
+	if (p1.y > clip.bottom) {
+		p1.x = clipAboveBelow(p1, mx, clip.bottom);
+		p1.y = clip.bottom;
 	}
 
 	// put p0 on left
@@ -306,40 +420,40 @@ inline void lineToEdges(std::vector<Edge>& edges, GPoint p0, GPoint p1, int heig
 
 	// chop/vertical segment for left and right boundaries
 	// if both on left
-	if (p1.x < 0) {
-		p0.x = 0;
-		p1.x = 0;
-		makeEdge(e, p0, p1, 0, 0);
+	if (p1.x < clip.left) {
+		p0.x = clip.left;
+		p1.x = clip.left;
+		makeEdge(e, p0, p1, 0, clip.left);
 		edges.push_back(e);
 		return;
 	}
 	
 	// if both on right
-	if (p0.x > width) {
-		p0.x = width;
-		p1.x = width;
-		makeEdge(e, p0, p1, 0, width);
+	if (p0.x > clip.right) {
+		p0.x = clip.right;
+		p1.x = clip.right;
+		makeEdge(e, p0, p1, 0, clip.right);
 		edges.push_back(e);
 		return;
 	}
 
 	// straddle left
-	if (p0.x < 0) {
-		proj.x = 0;
+	if (p0.x < clip.left) {
+		proj.x = clip.left;
 		proj.y = p0.y;
-		p0.y = clipSide(p0, my, 0);
-		p0.x = 0;
-		makeEdge(e, proj, p0, 0, 0);
+		p0.y = clipSide(p0, my, clip.left);
+		p0.x = clip.left;
+		makeEdge(e, proj, p0, 0, clip.left);
 		edges.push_back(e);
 	}
 
 	// straddle right
-	if (p1.x > width) {
-		proj.x = width;
+	if (p1.x > clip.right) {
+		proj.x = clip.right;
 		proj.y = p1.y;
-		p1.y = clipSide(p1, my, width);
-		p1.x = width;
-		makeEdge(e, proj, p1, 0, width);
+		p1.y = clipSide(p1, my, clip.right);
+		p1.x = clip.right;
+		makeEdge(e, proj, p1, 0, clip.right);
 		if (e.top < e.bottom)
 			edges.push_back(e);
 	}
@@ -348,7 +462,7 @@ inline void lineToEdges(std::vector<Edge>& edges, GPoint p0, GPoint p1, int heig
 	edges.push_back(e);
 }
 
-void lineToClippedWindingEdges(std::vector<Edge>& edges, GPoint p0, GPoint p1, int height, int width) {
+void lineToClippedWindingEdges(ArenaArray<Edge>& edges, GPoint p0, GPoint p1, const GIRect& clip) {
 	// calculate winding value
 	int winding = -1;
 
@@ -359,10 +473,10 @@ void lineToClippedWindingEdges(std::vector<Edge>& edges, GPoint p0, GPoint p1, i
 	}
 
 	// skip if both above
-	if (p1.y < 0)
+	if (p1.y < clip.top)
 		return;
 	// skip if both below
-	if (p0.y > height)
+	if (p0.y > clip.bottom)
 		return;
 
 	// check for horizontal lines
@@ -378,15 +492,15 @@ void lineToClippedWindingEdges(std::vector<Edge>& edges, GPoint p0, GPoint p1, i
 	float b = p0.x - p0.y * mx;
 
 	// straddle top
-	if (p0.y < 0) {
-		p0.x = clipAboveBelow(p0, mx, 0);
-		p0.y = 0;
+	if (p0.y < clip.top) {
+		p0.x = clipAboveBelow(p0, mx, clip.top);
+		p0.y = clip.top;
 	}
 
 	// straddle bottom
-	if (p1.y > height) {
-		p1.x = clipAboveBelow(p1, mx, height);
-		p1.y = height;
+	if (p1.y > clip.bottom) {
+		p1.x = clipAboveBelow(p1, mx, clip.bottom);
+		p1.y = clip.bottom;
 	}
 
 	// put p0 on left
@@ -396,10 +510,10 @@ void lineToClippedWindingEdges(std::vector<Edge>& edges, GPoint p0, GPoint p1, i
 
 	// chop/vertical segment for left and right boundaries
 	// if both on left
-	if (p1.x < 0) {
-		p0.x = 0;
-		p1.x = 0;
-		makeEdge(e, p0, p1, 0, 0);
+	if (p1.x < clip.left) {
+		p0.x = clip.left;
+		p1.x = clip.left;
+		makeEdge(e, p0, p1, 0, clip.left);
 		e.w = winding;
 		if (e.top < e.bottom)
 			edges.push_back(e);
@@ -407,10 +521,10 @@ void lineToClippedWindingEdges(std::vector<Edge>& edges, GPoint p0, GPoint p1, i
 	}
 	
 	// if both on right
-	if (p0.x > width) {
-		p0.x = width;
-		p1.x = width;
-		makeEdge(e, p0, p1, 0, width);
+	if (p0.x > clip.right) {
+		p0.x = clip.right;
+		p1.x = clip.right;
+		makeEdge(e, p0, p1, 0, clip.right);
 		e.w = winding;
 		if (e.top < e.bottom)
 			edges.push_back(e);
@@ -418,24 +532,24 @@ void lineToClippedWindingEdges(std::vector<Edge>& edges, GPoint p0, GPoint p1, i
 	}
 
 	// straddle left
-	if (p0.x < 0) {
-		proj.x = 0;
+	if (p0.x < clip.left) {
+		proj.x = clip.left;
 		proj.y = p0.y;
-		p0.y = clipSide(p0, my, 0);
-		p0.x = 0;
-		makeEdge(e, proj, p0, 0, 0);
+		p0.y = clipSide(p0, my, clip.left);
+		p0.x = clip.left;
+		makeEdge(e, proj, p0, 0, clip.left);
 		e.w = winding;
 		if (e.top < e.bottom)
 			edges.push_back(e);
 	}
 
 	// straddle right
-	if (p1.x > width) {
-		proj.x = width;
+	if (p1.x > clip.right) {
+		proj.x = clip.right;
 		proj.y = p1.y;
-		p1.y = clipSide(p1, my, width);
-		p1.x = width;
-		makeEdge(e, proj, p1, 0, width);
+		p1.y = clipSide(p1, my, clip.right);
+		p1.x = clip.right;
+		makeEdge(e, proj, p1, 0, clip.right);
 		e.w = winding;
 		if (e.top < e.bottom)
 			edges.push_back(e);
@@ -447,21 +561,21 @@ void lineToClippedWindingEdges(std::vector<Edge>& edges, GPoint p0, GPoint p1, i
 		edges.push_back(e);
 }
 
-inline void pointsToEdges(std::vector<Edge>& edges, const GPoint points[], unsigned n, int height, int width) {
+inline void pointsToEdges(ArenaArray<Edge>& edges, const GPoint points[], unsigned n, const GIRect& clip) {
 	for (int i=0; i<n-1; i++) {
-		lineToEdges(edges, points[i], points[i+1], height, width);
+		lineToEdges(edges, points[i], points[i+1], clip);
 	}
 	// closure
-	lineToEdges(edges, points[n-1], points[0], height, width);
+	lineToEdges(edges, points[n-1], points[0], clip);
 }
 
-inline void sortEdgesTop(std::vector<Edge>& edges) {
+inline void sortEdgesTop(ArenaArray<Edge>& edges) {
 	std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) {
         return a.top < b.top;
     });
 }
 
-inline void checkExpiration(Edge& firstEdge, Edge& secondEdge, int& nextIdx, std::vector<Edge>& edges, int y) {
+inline void checkExpiration(Edge& firstEdge, Edge& secondEdge, int& nextIdx, ArenaArray<Edge>& edges, int y) {
 	// check if first edge expired
 	if (firstEdge.bottom == y) {
 		firstEdge = edges[nextIdx];
@@ -485,44 +599,15 @@ inline void shootRay(int& left, int& right, Edge firstEdge, Edge secondEdge, flo
 	right = std::max(firstX, secondX);
 }
 
-void MyCanvas::drawConvexPolygon(const GPoint points[], int count, const GPaint& paint) {
-	if (count < 3)
-		return;
-	GBlendMode blendMode = paint.getBlendMode();
-	if (blendMode == GBlendMode::kDst)
-		return;
-
-	// src color
-	GPixel src;
-	
-	// check if Paint is using color or ptr to shader for src
-	bool usingShader = false;
-	GShader *sh = paint.peekShader();
-	if (sh != nullptr) {
-		if (!(sh->setContext(ctm)))
-			return;
-		usingShader = true;
-	} else {
-		src = makePixelFromPaint(paint);
-		// optimize blend mode
-		blendMode = optimizeBlendMode(blendMode, src);
-		if (blendMode == GBlendMode::kDst)
-			return;
-	}
-
-	// Transform points
-	GPoint mapped_points[count];
-	ctm.mapPoints(mapped_points, points, count);
-
-	// Device dimensions
-	int height = fDevice.height();
-	int width = fDevice.width();
-
-	// make edges
-	std::vector<Edge> edges;
-	edges.reserve(2 * count);
-	pointsToEdges(edges, mapped_points, count, height, width);
+// Scan convert a convex polygon (already in device space) into one span per row.
+static void convexToSpans(const GPoint points[], int count, const GIRect& clip, Arena* arena, SpanList* spans,
+						  CanvasStats* stats) {
+	// make edges; clipping splits a line into at most 3
+	ArenaArray<Edge> edges(arena, 3 * count);
+	pointsToEdges(edges, points, count, clip);
 	int numEdges = edges.size();
+	if (stats)
+		stats->edges += numEdges;
 	if (numEdges < 2)
 		return;
 
@@ -544,301 +629,59 @@ void MyCanvas::drawConvexPolygon(const GPoint points[], int count, const GPaint&
 	// left and right blit row bounds
 	int left = 0;
 	int right = 0;
-	GPixel *row_addr = nullptr;
-	float ray = 0.0f;
-	int range = 0;
-	if (usingShader) {
-		if (sh->isOpaque())
-			blendMode = optimizeOpaqueBlendMode(blendMode);
-		GPixel srcRow[width];
-		switch (blendMode) {
-			case GBlendMode::kClear:
-				for (int y=top; y<bottom; y++) {
-					checkExpiration(firstEdge, secondEdge, nextIdx, edges, y);
-					ray = y + 0.5f;
-					shootRay(left, right, firstEdge, secondEdge, ray);
-					range = right - left;
-					if (range > 0) {
-						row_addr = fDevice.getAddr(left, y);
-						clearRow(row_addr, range);
-					}
-				}
-				break;
-			case GBlendMode::kSrc:
-				for (int y=top; y<bottom; y++) {
-					checkExpiration(firstEdge, secondEdge, nextIdx, edges, y);
-					ray = y + 0.5f;
-					shootRay(left, right, firstEdge, secondEdge, ray);
-					range = right - left;
-					if (range > 0) {
-						row_addr = fDevice.getAddr(left, y);
-						sh->shadeRow(left, y, range, srcRow);
-						storeRowSR(row_addr, range, srcRow);
-					}	
-				}
-				break;
-			case GBlendMode::kSrcOver:
-				for (int y=top; y<bottom; y++) {
-					checkExpiration(firstEdge, secondEdge, nextIdx, edges, y);
-					ray = y + 0.5f;
-					shootRay(left, right, firstEdge, secondEdge, ray);
-					range = right - left;
-					if (range > 0) {
-						row_addr = fDevice.getAddr(left, y);
-						sh->shadeRow(left, y, range, srcRow);
-						blitSrcOverSR(row_addr, range, srcRow);
-					}
-				}
-				break;
-			case GBlendMode::kDstOver:
-				for (int y=top; y<bottom; y++) {
-					checkExpiration(firstEdge, secondEdge, nextIdx, edges, y);
-					ray = y + 0.5f;
-					shootRay(left, right, firstEdge, secondEdge, ray);
-					range = right - left;
-					if (range > 0) {
-						row_addr = fDevice.getAddr(left, y);
-						sh->shadeRow(left, y, range, srcRow);
-						blitDstOverSR(row_addr, range, srcRow);
-					}
-				}
-				break;
-			case GBlendMode::kSrcIn:
-				for (int y=top; y<bottom; y++) {
-					checkExpiration(firstEdge, secondEdge, nextIdx, edges, y);
-					ray = y + 0.5f;
-					shootRay(left, right, firstEdge, secondEdge, ray);
-					range = right - left;
-					if (range > 0) {
-						row_addr = fDevice.getAddr(left, y);
-						sh->shadeRow(left, y, range, srcRow);
-						blitSrcInSR(row_addr, range, srcRow);
-					}
-				}
-				break;
-			case GBlendMode::kDstIn:
-				for (int y=top; y<bottom; y++) {
-					checkExpiration(firstEdge, secondEdge, nextIdx, edges, y);
-					ray = y + 0.5f;
-					shootRay(left, right, firstEdge, secondEdge, ray);
-					range = right - left;
-					if (range > 0) {
-						row_addr = fDevice.getAddr(left, y);
-						sh->shadeRow(left, y, range, srcRow);
-						blitDstInSR(row_addr, range, srcRow);
-					}
-				}
-				break;
-			case GBlendMode::kSrcOut:
-				for (int y=top; y<bottom; y++) {
-					checkExpiration(firstEdge, secondEdge, nextIdx, edges, y);
-					ray = y + 0.5f;
-					shootRay(left, right, firstEdge, secondEdge, ray);
-					range = right - left;
-					if (range > 0) {
-						row_addr = fDevice.getAddr(left, y);
-						sh->shadeRow(left, y, range, srcRow);
-						blitSrcOutSR(row_addr, range, srcRow);
-					}
-				}
-				break;
-			case GBlendMode::kDstOut:
-				for (int y=top; y<bottom; y++) {
-					checkExpiration(firstEdge, secondEdge, nextIdx, edges, y);
-					ray = y + 0.5f;
-					shootRay(left, right, firstEdge, secondEdge, ray);
-					range = right - left;
-					if (range > 0) {
-						row_addr = fDevice.getAddr(left, y);
-						sh->shadeRow(left, y, range, srcRow);
-						blitDstOutSR(row_addr, range, srcRow);
-					}
-				}
-				break;
-			case GBlendMode::kSrcATop:
-				for (int y=top; y<bottom; y++) {
-					checkExpiration(firstEdge, secondEdge, nextIdx, edges, y);
-					ray = y + 0.5f;
-					shootRay(left, right, firstEdge, secondEdge, ray);
-					range = right - left;
-					if (range > 0) {
-						row_addr = fDevice.getAddr(left, y);
-						sh->shadeRow(left, y, range, srcRow);
-						blitSrcATopSR(row_addr, range, srcRow);
-					}
-				}
-				break;
-			case GBlendMode::kDstATop:
-				for (int y=top; y<bottom; y++) {
-					checkExpiration(firstEdge, secondEdge, nextIdx, edges, y);
-					ray = y + 0.5f;
-					shootRay(left, right, firstEdge, secondEdge, ray);
-					range = right - left;
-					if (range > 0) {
-						row_addr = fDevice.getAddr(left, y);
-						sh->shadeRow(left, y, range, srcRow);
-						blitDstATopSR(row_addr, range, srcRow);
-					}
-				}
-				break;
-			case GBlendMode::kXor:
-				for (int y=top; y<bottom; y++) {
-					checkExpiration(firstEdge, secondEdge, nextIdx, edges, y);
-					ray = y + 0.5f;
-					shootRay(left, right, firstEdge, secondEdge, ray);
-					range = right - left;
-					if (range > 0) {
-						row_addr = fDevice.getAddr(left, y);
-						sh->shadeRow(left, y, range, srcRow);
-						blitXorBlendSR(row_addr, range, srcRow);
-					}
-				}
-				break;
-			default:
-				break;
-		}
-	} else {
-		switch (blendMode) {
-			case GBlendMode::kClear:
-				for (int y=top; y<bottom; y++) {
-					checkExpiration(firstEdge, secondEdge, nextIdx, edges, y);
-					ray = y + 0.5f;
-					shootRay(left, right, firstEdge, secondEdge, ray);
-					range = right - left;
-					if (range > 0) {
-						row_addr = fDevice.getAddr(left, y);
-						clearRow(row_addr, range);
-					}
-				}
-				break;
-			case GBlendMode::kSrc:
-				for (int y=top; y<bottom; y++) {
-					checkExpiration(firstEdge, secondEdge, nextIdx, edges, y);
-					ray = y + 0.5f;
-					shootRay(left, right, firstEdge, secondEdge, ray);
-					range = right - left;
-					if (range > 0) {
-						row_addr = fDevice.getAddr(left, y);
-						storeRow(row_addr, range, src);
-					}
-				}
-				break;
-			case GBlendMode::kSrcOver:
-				for (int y=top; y<bottom; y++) {
-					checkExpiration(firstEdge, secondEdge, nextIdx, edges, y);
-					ray = y + 0.5f;
-					shootRay(left, right, firstEdge, secondEdge, ray);
-					range = right - left;
-					if (range > 0) {
-						row_addr = fDevice.getAddr(left, y);
-						blitSrcOver(row_addr, range, src);
-					}
-				}
-				break;
-			case GBlendMode::kDstOver:
-				for (int y=top; y<bottom; y++) {
-					checkExpiration(firstEdge, secondEdge, nextIdx, edges, y);
-					ray = y + 0.5f;
-					shootRay(left, right, firstEdge, secondEdge, ray);
-					range = right - left;
-					if (range > 0) {
-						row_addr = fDevice.getAddr(left, y);
-						blitDstOver(row_addr, range, src);
-					}
-				}
-				break;	
-			case GBlendMode::kSrcIn:
-				for (int y=top; y<bottom; y++) {
-					checkExpiration(firstEdge, secondEdge, nextIdx, edges, y);
-					ray = y + 0.5f;
-					shootRay(left, right, firstEdge, secondEdge, ray);
-					range = right - left;
-					if (range > 0) {
-						row_addr = fDevice.getAddr(left, y);
-						blitSrcIn(row_addr, range, src);
-					}
-				}
-				break;
-			case GBlendMode::kDstIn:
-				for (int y=top; y<bottom; y++) {
-					checkExpiration(firstEdge, secondEdge, nextIdx, edges, y);
-					ray = y + 0.5f;
-					shootRay(left, right, firstEdge, secondEdge, ray);
-					range = right - left;
-					if (range > 0) {
-						row_addr = fDevice.getAddr(left, y);
-						blitDstIn(row_addr, range, src);
-					}
-				}
-				break;
-			case GBlendMode::kSrcOut:
-				for (int y=top; y<bottom; y++) {
-					checkExpiration(firstEdge, secondEdge, nextIdx, edges, y);
-					ray = y + 0.5f;
-					shootRay(left, right, firstEdge, secondEdge, ray);
-					range = right - left;
-					if (range > 0) {
-						row_addr = fDevice.getAddr(left, y);
-						blitSrcOut(row_addr, range, src);
-					}
-				}
-				break;
-			case GBlendMode::kDstOut:
-				for (int y=top; y<bottom; y++) {
-					checkExpiration(firstEdge, secondEdge, nextIdx, edges, y);
-					ray = y + 0.5f;
-					shootRay(left, right, firstEdge, secondEdge, ray);
-					range = right - left;
-					if (range > 0) {
-						row_addr = fDevice.getAddr(left, y);
-						blitDstOut(row_addr, range, src);
-					}
-				}
-				break;
-			case GBlendMode::kSrcATop:
-				for (int y=top; y<bottom; y++) {
-					checkExpiration(firstEdge, secondEdge, nextIdx, edges, y);
-					ray = y + 0.5f;
-					shootRay(left, right, firstEdge, secondEdge, ray);
-					range = right - left;
-					if (range > 0) {
-						row_addr = fDevice.getAddr(left, y);
-						blitSrcATop(row_addr, range, src);
-					}
-				}
-				break;
-			case GBlendMode::kDstATop:
-				for (int y=top; y<bottom; y++) {
-					checkExpiration(firstEdge, secondEdge, nextIdx, edges, y);
-					ray = y + 0.5f;
-					shootRay(left, right, firstEdge, secondEdge, ray);
-					range = right - left;
-					if (range > 0) {
-						row_addr = fDevice.getAddr(left, y);
-						blitDstATop(row_addr, range, src);
-					}
-				}
-				break;
-			case GBlendMode::kXor:
-				for (int y=top; y<bottom; y++) {
-					checkExpiration(firstEdge, secondEdge, nextIdx, edges, y);
-					ray = y + 0.5f;
-					shootRay(left, right, firstEdge, secondEdge, ray);
-					range = right - left;
-					if (range > 0) {
-						row_addr = fDevice.getAddr(left, y);
-						blitXorBlend(row_addr, range, src);
-					}
-				}
-				break;
-			default:
-				break;
-		}
+	for (int y=top; y<bottom; y++) {
+		checkExpiration(firstEdge, secondEdge, nextIdx, edges, y);
+		shootRay(left, right, firstEdge, secondEdge, y + 0.5f);
+		if (right > left)
+			spans->add(y, left, right);
+	}
+}
+
+void MyCanvas::rasterizeConvexPolygon(const GPoint points[], int count, SpanList* spans) {
+	if (count < 3)
+		return;
+	// Transform points
+	GPoint* mapped_points = fArena.makeArray<GPoint>(count);
+	ctm.mapPoints(mapped_points, points, count);
+
+	// reject polygons entirely outside the clip before building edges
+	GRect r = GRect::LTRB(mapped_points[0].x, mapped_points[0].y, mapped_points[0].x, mapped_points[0].y);
+	for (int i=1; i<count; i++) {
+		r.left = std::min(r.left, mapped_points[i].x);
+		r.top = std::min(r.top, mapped_points[i].y);
+		r.right = std::max(r.right, mapped_points[i].x);
+		r.bottom = std::max(r.bottom, mapped_points[i].y);
 	}
+	if (!irectsIntersect(r.roundOut(), fClip.bounds()))
+		return;
+	convexToSpans(mapped_points, count, fClip.bounds(), &fArena, spans, fStats);
+}
+
+void MyCanvas::drawConvexPolygon(const GPoint points[], int count, const GPaint& paint) {
+	TraceScope trace(fTrace, &fTraceEvent, "drawConvexPolygon");
+	if (fStats)
+		fStats->draws.convexPolygon++;
+	if (count < 3)
+		return;
+	fArena.reset();
+	this->fillConvexPolygon(points, count, paint, this->bandPool());
+}
+
+void MyCanvas::fillConvexPolygon(const GPoint points[], int count, const GPaint& paint, ThreadPool* pool) {
+	// rasterize first, so a polygon outside the clip (most mesh triangles, for a tile canvas)
+	// never sets up its shader
+	SpanList spans(&fArena);
+	rasterizeConvexPolygon(points, count, &spans);
+	if (spans.isEmpty())
+		return;
+	SpanBlitter blitter(fDevice, fArena, fClip, fTile, fStats, fTraceEvent, fOverdraw);
+	if (!blitter.setup(paint, ctm))
+		return;
+	blitter.blitSpans(spans, pool);
 }
 
 
-inline void sortEdgesTopAndX(std::vector<Edge>& edges) {
+inline void sortEdgesTopAndX(ArenaArray<Edge>& edges) {
 	std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) {
         if (a.top != b.top) {
 			// Sort by top first
@@ -849,248 +692,76 @@ inline void sortEdgesTopAndX(std::vector<Edge>& edges) {
     });	
 }
 
-// inline void sortEdgesX(std::vector<Edge>& edges, size_t k) {
+// inline void sortEdgesX(ArenaArray<Edge>& edges, size_t k) {
 // 	assert(k <= edges.size());
 // 	std::sort(edges.begin(), edges.begin() + k, [](const Edge& a, const Edge& b) {
 //         return a.x < b.x;
 //     });
 // }
 
-inline void sortEdgesX(std::list<Edge>& edges, size_t k) {
-    assert(k <= edges.size()); // Ensure k is not greater than the list size
-	// temp vector
-	std::vector<Edge> temp;
-    auto it = edges.begin();
-    for (size_t i = 0; i < k; ++i) {
-        temp.push_back(*it);
-        ++it;
-    }
-
-    // sort the vector
-    std::sort(temp.begin(), temp.end(), [](const Edge& a, const Edge& b) {
-        return a.x < b.x;
-    });
-
-    // replace the first k elements in the list with the sorted elements
-    it = edges.begin();
-    for (const auto& edge : temp) {
-        *it = edge;
-        ++it;
-    }
-}
-
-inline void makeEdgeFromArgs(Edge& e, int top, int bottom, float m, float b, int w) {
-	e.top = top;
-	e.bottom = bottom; 
-	e.m = m;
-	e.b = b;
-	e.w = w;
-}
-
 // PA 4
-void MyCanvas::drawPath(const GPath& path, const GPaint& paint) {
-	size_t count = path.countPoints();
-	if (count < 3) return;
-	GBlendMode blendMode = paint.getBlendMode();
-	if (blendMode == GBlendMode::kDst) return;
-
-	// src color
-	GPixel src;
-
-	// Check if paint is using color or ptr to shader for src
-	bool usingShader = false;
-	GShader *sh = paint.peekShader();
-	if (sh != nullptr) {
-		if (!(sh->setContext(ctm))) return;
-		usingShader = true;
-	} else {
-		src = makePixelFromPaint(paint);
-		// optimize blend mode
-		blendMode = optimizeBlendMode(blendMode, src);
-		if (blendMode == GBlendMode::kDst) return;
-	}
-	// if rect is outside of bounds, return
-	// if rect is all in bounds, don't clip
-
-	// Device dimensions
-	int height = fDevice.height();
-	int width = fDevice.width();
-
-	// Get edges from path
-	std::shared_ptr<GPath> transformedPath = path.transform(ctm);
-	GPath::Edger edger(*transformedPath);
+// Segments are mapped by matrix as they are read, so the path is never copied to device space.
+static void pathToEdges(ArenaArray<Edge>& edges, const GPath& path, const GMatrix& matrix, const GIRect& clip,
+						CanvasStats* stats) {
+	GPath::Edger edger(path);
 	GPoint pts[GPath::kMaxNextPoints];
-	// check if clipping is neccessary
-	// GRect bounding_box = transformedPath->bounds();
-	bool needClip = true;
-	//TODO: fix bounds
-	// if (bounding_box.right < 0 ||
-	// 	bounding_box.bottom < 0 ||
-	// 	bounding_box.left > width ||
-	// 	bounding_box.top > height) {
-	// 	return;
-	// } else if (bounding_box.left >= 0 &&
-    //             bounding_box.right <= width &&
-    //             bounding_box.top >= 0 &&
-    //             bounding_box.bottom <= height) {
-	// 				needClip = false;
-	// }
-	std::vector<Edge> edges;
-	Edge e;
-	edges.reserve(2 * count);
 	GPoint error, error2, p0, p1;
 	float tolerance = 1.0f/4.0f;
-	float mx, b, t, dt;
-	int num_segs, w, edgeTop, edgeBottom;
-	if (needClip) {
-		while (auto v = edger.next(pts)) {
-			switch (v.value()) {
-				case GPathVerb::kLine:
-					lineToClippedWindingEdges(edges, pts[0], pts[1], height, width);
-					break;
-				case GPathVerb::kQuad:
-					p0 = pts[0];
-					p1 = pts[0];
-					error = (pts[0] - 2*pts[1] + pts[2])*(1.0f/4.0f);
-					num_segs = (int)ceil(sqrt(error.length()/tolerance));
-					t = 0.0f;
-					dt = 1.0f / num_segs;
-					for (int i=0; i<num_segs-1; i++) {
-						//p0 = evalQuadPoint(pts[0], pts[1], pts[2], t);
-						p1 = evalQuadPoint(pts[0], pts[1], pts[2], t + dt);
-						lineToClippedWindingEdges(edges, p0, p1, height, width);
-						p0 = p1;
-						t += dt;
-					}
-					lineToClippedWindingEdges(edges, p1, pts[2], height, width);
-					break;
-				case GPathVerb::kCubic:
-					error = pts[0] - 2*pts[1] + pts[2];
-					error2 = pts[1] - 2*pts[2] + pts[3];
-					error.x = std::max(abs(error.x), abs(error2.x));
-					error.y = std::max(abs(error.y), abs(error2.y));
-					num_segs = (int)ceil(sqrt((3*error.length())/(4.0f*tolerance)));
-					t = 0.0f;
-					dt = 1.0f / num_segs;
-					p0 = pts[0];
-					p1 = pts[0];
-					for (int i=0; i<num_segs-1; i++) {
-						//p0 = evalCubicPoint(pts[0], pts[1], pts[2], pts[3], t);
-						p1 = evalCubicPoint(pts[0], pts[1], pts[2], pts[3], t + dt);
-						lineToClippedWindingEdges(edges, p0, p1, height, width);
-						p0 = p1;
-						t += dt;
-					}
-					lineToClippedWindingEdges(edges, p1, pts[3], height, width);
-					break;
-				default:
-					break;
-			}
-		}
-	} else {
-		while (auto v = edger.next(pts)) {
-			switch (v.value()) {
-				case GPathVerb::kLine:
-					p0 = pts[0];
-					p1 = pts[0];
-					edgeTop = GRoundToInt(std::min(p0.y, p1.y));
-					edgeBottom = GRoundToInt(std::max(p0.y, p1.y));
-					if (edgeTop >= edgeBottom)
-						continue;
-					mx = (p1.x - p0.x) / (p1.y - p0.y);
-					b = p0.x - p0.y * mx;
-					w = -1;
-					if (p0.y > p1.y)
-						w = 1;
-					makeEdgeFromArgs(e, edgeTop, edgeBottom, mx, b, w);
-					edges.push_back(e);
-					break;
-				case GPathVerb::kQuad:
-					error = (pts[0] - 2*pts[1] + pts[2])*(1.0f/4.0f);
-					num_segs = (int)ceil(sqrt(error.length()/tolerance));
-					t = 0.0f;
-					dt = 1.0f / num_segs;
-					p0 = pts[0];
-					p1 = pts[0];
-					for (int i=0; i<num_segs-1; i++) {
-						//p0 = evalQuadPoint(pts[0], pts[1], pts[2], t);
-						p1 = evalQuadPoint(pts[0], pts[1], pts[2], t + dt);
-						edgeTop = GRoundToInt(std::min(p0.y, p1.y));
-						edgeBottom = GRoundToInt(std::max(p0.y, p1.y));
-						if (edgeTop >= edgeBottom)
-							continue;
-						mx = (p1.x - p0.x) / (p1.y - p0.y);
-						b = p0.x - p0.y * mx;
-						w = -1;
-						if (p0.y > p1.y)
-							w = 1;
-						makeEdgeFromArgs(e, edgeTop, edgeBottom, mx, b, w);
-						edges.push_back(e);
-						t += dt;
-						p0 = p1;
-					}
+	float t, dt;
+	int num_segs;
+	while (auto v = edger.next(pts)) {
+		matrix.mapPoints(pts, (int)v.value() + 1);	// kLine, kQuad, kCubic use 2, 3, 4 points
+		switch (v.value()) {
+			case GPathVerb::kLine:
+				lineToClippedWindingEdges(edges, pts[0], pts[1], clip);
+				break;
+			case GPathVerb::kQuad:
+				p0 = pts[0];
+				p1 = pts[0];
+				error = (pts[0] - 2*pts[1] + pts[2])*(1.0f/4.0f);
+				num_segs = (int)ceil(sqrt(error.length()/tolerance));
+				if (stats)
+					stats->curveSegments += num_segs;
+				t = 0.0f;
+				dt = 1.0f / num_segs;
+				for (int i=0; i<num_segs-1; i++) {
+					p1 = evalQuadPoint(pts[0], pts[1], pts[2], t + dt);
+					lineToClippedWindingEdges(edges, p0, p1, clip);
 					p0 = p1;
-					p1 = pts[2];
-					edgeTop = GRoundToInt(std::min(p0.y, p1.y));
-					edgeBottom = GRoundToInt(std::max(p0.y, p1.y));
-					if (edgeTop >= edgeBottom)
-						continue;
-					mx = (p1.x - p0.x) / (p1.y - p0.y);
-					b = p0.x - p0.y * mx;
-					w = -1;
-					if (p0.y > p1.y)
-						w = 1;
-					makeEdgeFromArgs(e, edgeTop, edgeBottom, mx, b, w);
-					edges.push_back(e);
-					break;
-				case GPathVerb::kCubic:
-					error = pts[0] - 2*pts[1] + pts[2];
-					error2 = pts[1] - 2*pts[2] + pts[3];
-					error.x = std::max(abs(error.x), abs(error2.x));
-					error.y = std::max(abs(error.y), abs(error2.y));
-					num_segs = (int)ceil(sqrt((3*error.length())/(4.0f*tolerance)));
-					t = 0.0f;
-					dt = 1.0f / num_segs;
-					p0 = pts[0];
-					p1 = pts[0];
-					for (int i=0; i<num_segs-1; i++) {
-						//p0 = evalCubicPoint(pts[0], pts[1], pts[2], pts[3], t);
-						p1 = evalCubicPoint(pts[0], pts[1], pts[2], pts[3], t + dt);
-						edgeTop = GRoundToInt(std::min(p0.y, p1.y));
-						edgeBottom = GRoundToInt(std::max(p0.y, p1.y));
-						if (edgeTop >= edgeBottom)
-							continue;
-						mx = (p1.x - p0.x) / (p1.y - p0.y);
-						b = p0.x - p0.y * mx;
-						w = -1;
-						if (p0.y > p1.y)
-							w = 1;
-						makeEdgeFromArgs(e, edgeTop, edgeBottom, mx, b, w);
-						edges.push_back(e);	
-						p0 = p1;
-						t += dt;
-					}
+					t += dt;
+				}
+				lineToClippedWindingEdges(edges, p1, pts[2], clip);
+				break;
+			case GPathVerb::kCubic:
+				error = pts[0] - 2*pts[1] + pts[2];
+				error2 = pts[1] - 2*pts[2] + pts[3];
+				error.x = std::max(abs(error.x), abs(error2.x));
+				error.y = std::max(abs(error.y), abs(error2.y));
+				num_segs = (int)ceil(sqrt((3*error.length())/(4.0f*tolerance)));
+				if (stats)
+					stats->curveSegments += num_segs;
+				t = 0.0f;
+				dt = 1.0f / num_segs;
+				p0 = pts[0];
+				p1 = pts[0];
+				for (int i=0; i<num_segs-1; i++) {
+					p1 = evalCubicPoint(pts[0], pts[1], pts[2], pts[3], t + dt);
+					lineToClippedWindingEdges(edges, p0, p1, clip);
 					p0 = p1;
-					p1 = pts[3];
-					edgeTop = GRoundToInt(std::min(p0.y, p1.y));
-					edgeBottom = GRoundToInt(std::max(p0.y, p1.y));
-					if (edgeTop >= edgeBottom)
-						continue;
-					mx = (p1.x - p0.x) / (p1.y - p0.y);
-					b = p0.x - p0.y * mx;
-					w = -1;
-					if (p0.y > p1.y)
-						w = 1;
-					makeEdgeFromArgs(e, edgeTop, edgeBottom, mx, b, w);
-					edges.push_back(e);
-					break;
-				default:
-					break;
-			}
+					t += dt;
+				}
+				lineToClippedWindingEdges(edges, p1, pts[3], clip);
+				break;
+			default:
+				break;
 		}
 	}
+}
 
-	size_t numEdges = edges.size();
+// Walk the winding edges top to bottom, calling blit(y, L, R) for every filled run.
+template <typename Blitter>
+static void scanWindingEdges(ArenaArray<Edge>& edges, Blitter&& blit) {
+	int numEdges = edges.size();
 	if (numEdges < 2) return;
 
 	// find top and bottom and first ray intersect x
@@ -1110,119 +781,125 @@ void MyCanvas::drawPath(const GPath& path, const GPaint& paint) {
 	// sort edges based on top and x
 	sortEdgesTopAndX(edges);
 
-	// linked list for deletion
-	std::list<Edge> edgeList(edges.begin(), edges.end());
-	auto it = edgeList.begin();
+	// edges still to finish are [first, end), in order; expired ones are dropped by packing
+	// the survivors up against the unvisited rest
+	Edge* first = edges.begin();
+	Edge* end = edges.end();
+	auto byX = [](const Edge& a, const Edge& b) { return a.x < b.x; };
 	// loop through all y's containing edges
-	int blendModeInt = (int) blendMode;
-	int range = 0;
-	GPixel *row_addr = nullptr;
-	
-	if (usingShader) {
-		if (sh->isOpaque())
-			blendMode = optimizeOpaqueBlendMode(blendMode);
-		GPixel srcRow[width];
-		BlitRowSRProc blitRowSR = gblitRowSRProcs[blendModeInt];
-		for (int y=top; y<bottom; y++) {
-			size_t i = 0;
-			int w = 0;
-			int L = 0;
-			// loop through actice edges for this y value
-			while (i < numEdges && (*it).valid(y)) {
-				int x = GRoundToInt((*it).computeX(y));
-				if (w == 0)
-					L = x;
-				w += (*it).w;
-				if (w == 0) {
-					int R = x;
-					range = R - L;
-					if (range > 0) {
-						row_addr = fDevice.getAddr(L, y);
-						sh->shadeRow(L, y, range, srcRow);
-						blitRowSR(row_addr, range, srcRow);
-					}
-				}
+	for (int y=top; y<bottom; y++) {
+		int w = 0;
+		int L = 0;
+		// loop through active edges for this y value
+		Edge* e = first;
+		for (; e < end && e->valid(y); e++) {
+			int x = GRoundToInt(e->computeX(y));
+			if (w == 0)
+				L = x;
+			w += e->w;
+			if (w == 0 && x > L)
+				blit(y, L, x);
+		}
+		assert(w == 0);
+		Edge* kept = e;
+		for (Edge* k = e; k-- > first; ) {
+			if (k->valid(y+1))
+				*--kept = *k;
+		}
+		first = kept;
 
-				if ((*it).valid(y+1)) {
-					i += 1;
-					++it;
-				} else {
-					// TODO: fix
-					it = edgeList.erase(it);
-					numEdges -= 1;
-				}
-			}
-			assert(w == 0);
-			// now i is the number of remaining valid edges
+		// account for new edges that will be valid for next y
+		while (e < end && e->valid(y+1))
+			e++;
 
-			// account for new edges that will be valid for next y
-			while (i < numEdges && (*it).valid(y+1)) {
-				i += 1;
-				++it;
-			}
+		for (Edge* k = first; k < e; k++)
+			k->x = k->computeX(y+1);
+		std::sort(first, e, byX);
+	}
+}
 
-			// now i also includes the number of edges that will be valid
-			// i = std::min(i, edges.size());
-			it = edgeList.begin();
-			for (int j=0; j<i; j++) {
-				(*it).x = (*it).computeX(y+1);
-				++it;
-			}
-			// edges.assign(edgeList.begin(), edgeList.end());
-			sortEdgesX(edgeList, i);
-			// edgeList.assign(edges.begin(), edges.end());
-			it = edgeList.begin();
-		}
-	} else {
-		BlitRowProc blitRow = gblitRowProcs[blendModeInt];
-		for (int y=top; y<bottom; y++) {
-			size_t i = 0;
-			int w = 0;
-			int L = 0;
-			// loop through active edges for this y value
-			while (i < numEdges && (*it).valid(y)) {
-				int x = GRoundToInt((*it).computeX(y));
-				if (w == 0)
-					L = x;
-				w += (*it).w;
-				if (w == 0) {
-					int R = x;
-					range = R - L;
-					if (range > 0) {
-						row_addr = fDevice.getAddr(L, y);
-						blitRow(row_addr, range, src);
-					}
-				}
+// Rasterize path mapped by matrix into spans inside clip.
+static void pathToSpans(const GPath& path, const GMatrix& matrix, const GIRect& clip, Arena* arena, SpanList* spans,
+						CanvasStats* stats) {
+	ArenaArray<Edge> edges(arena, 2 * (int)path.countPoints());
+	pathToEdges(edges, path, matrix, clip, stats);
+	if (stats)
+		stats->edges += edges.size();
+	scanWindingEdges(edges, [spans](int y, int L, int R) {
+		spans->add(y, L, R);
+	});
+}
 
-				if ((*it).valid(y+1)) {
-					i += 1;
-					++it;
-				} else {
-					it = edgeList.erase(it);
-					numEdges -= 1;
-				}
-			}
-			assert(w == 0);
-			// now i is the number of remaining valid edges
+void MyCanvas::setPathCacheBudget(size_t bytes) {
+	fPathCache.setBudget(bytes);
+}
 
-			// account for new edges that will be valid for next y
-			while (i < numEdges && (*it).valid(y+1)) {
-				i += 1;
-				++it;
-			}
+const PathCacheStats& MyCanvas::pathCacheStats() const {
+	return fPathCache.stats();
+}
 
-			// now i also includes the number of edges that will be valid
-			// i = std::min(i, edges.size());
-			it = edgeList.begin();
-			for (int j=0; j<i; j++) {
-				(*it).x = (*it).computeX(y+1);
-				++it;
-			}
-			// edges.assign(edgeList.begin(), edgeList.end());
-			sortEdgesX(edgeList, i);
-			// edgeList.assign(edges.begin(), edges.end());
-			it = edgeList.begin();
-		}	
+void MyCanvas::rasterizePath(const GPath& path, SpanList* spans) {
+	if (path.countPoints() < 3)
+		return;
+	// reject paths entirely outside the clip before building edges; the slack covers
+	// flattened curves rounding outside the exact bounds
+	GIRect devBounds = mapRectBounds(ctm, path.bounds()).roundOut();
+	devBounds = GIRect::LTRB(devBounds.left - 1, devBounds.top - 1, devBounds.right + 1, devBounds.bottom + 1);
+	if (!irectsIntersect(devBounds, fClip.bounds()))
+		return;
+	pathToSpans(path, ctm, fClip.bounds(), &fArena, spans, fStats);
+}
+
+void MyCanvas::drawPath(const GPath& path, const GPaint& paint) {
+	TraceScope trace(fTrace, &fTraceEvent, "drawPath");
+	if (fStats)
+		fStats->draws.path++;
+	if (path.countPoints() < 3) return;
+	fArena.reset();
+	SpanBlitter blitter(fDevice, fArena, fClip, fTile, fStats, fTraceEvent, fOverdraw);
+	if (!blitter.setup(paint, ctm)) return;
+
+	if (fPathCache.budget() == 0) {
+		SpanList spans(&fArena);
+		rasterizePath(path, &spans);
+		blitter.blitSpans(spans, this->bandPool());
+		return;
+	}
+
+	GMatrix rasterMatrix;
+	int ix, iy;
+	const PathCacheKey& key = fPathCache.makeKey(path, ctm, &rasterMatrix, &ix, &iy);
+	const PathCacheEntry* entry = fPathCache.find(key);
+	PathCacheEntry fresh;
+	if (!entry) {
+		// rasterize into a local box that covers the path's control points
+		std::shared_ptr<GPath> local = path.transform(rasterMatrix);
+		GRect r = local->bounds();
+		fresh.key = key;
+		fresh.originX = GFloorToInt(r.left) - 1;
+		fresh.originY = GFloorToInt(r.top) - 1;
+		local = local->offset((float)-fresh.originX, (float)-fresh.originY);
+		SpanList spans(&fArena);
+		pathToSpans(*local, GMatrix(), GIRect::WH(GCeilToInt(r.right) - fresh.originX + 1,
+									   GCeilToInt(r.bottom) - fresh.originY + 1), &fArena, &spans, fStats);
+		fresh.spans.assign(spans.begin(), spans.end());
+		entry = &fresh;
+		if (const PathCacheEntry* cached = fPathCache.add(std::move(fresh)))
+			entry = cached;
+	}
+
+	// blit the spans clipped to the clip
+	const GIRect& clip = fClip.bounds();
+	int dx = ix + entry->originX;
+	int dy = iy + entry->originY;
+	for (const Span& s : entry->spans) {
+		int y = s.y + dy;
+		if (y < clip.top || y >= clip.bottom)
+			continue;
+		int L = std::max(s.left + dx, clip.left);
+		int R = std::min(s.right + dx, clip.right);
+		if (L < R)
+			blitter.blit(y, L, R);
 	}
 }
 
@@ -1397,17 +1074,44 @@ std::string GDrawSomething(GCanvas* canvas, GISize dim) {
 // PA3
 void MyCanvas::save() {
 	matrix_stack.push_back(ctm);
+	clip_stack.push_back({fClip, fClipArena.mark()});
 }
 
 void MyCanvas::restore() {
 	ctm = matrix_stack.back();
 	matrix_stack.pop_back();
+	fClip = clip_stack.back().clip;
+	fClipArena.rewind(clip_stack.back().mark);
+	clip_stack.pop_back();
 }
 
 void MyCanvas::concat(const GMatrix& matrix) {
 	ctm = ctm * matrix;
 }
 
+void MyCanvas::clipRect(const GRect& rect) {
+	TraceScope trace(fTrace, &fTraceEvent, "clipRect");
+	if (ctm.isScaleTranslate()) {
+		GRegion r(mapAxisAlignedRect(ctm, rect).round());
+		fClip = GRegion::Intersect(fClip, r, &fClipArena);
+		return;
+	}
+	const GPoint points[] = { {rect.left, rect.top}, {rect.right, rect.top}, {rect.right, rect.bottom}, {rect.left, rect.bottom} };
+	fArena.reset();
+	SpanList spans(&fArena);
+	rasterizeConvexPolygon(points, 4, &spans);
+	GRegion shape = GRegion::FromSpans(spans.begin(), spans.count(), &fClipArena);
+	fClip = GRegion::Intersect(fClip, shape, &fClipArena);
+}
+
+void MyCanvas::clipPath(const GPath& path) {
+	TraceScope trace(fTrace, &fTraceEvent, "clipPath");
+	fArena.reset();
+	SpanList spans(&fArena);
+	rasterizePath(path, &spans);
+	GRegion shape = GRegion::FromSpans(spans.begin(), spans.count(), &fClipArena);
+	fClip = GRegion::Intersect(fClip, shape, &fClipArena);
+}
 
 // PA6
 // void drawTriangleWithTex(const GPoint pts[3], const GPoint tex[3], GShader* originalShader) {
@@ -1439,23 +1143,39 @@ void MyCanvas::concat(const GMatrix& matrix) {
 //     }
 // };
 
+bool MyCanvas::quickRejectTriangle(const GPoint& p0, const GPoint& p1, const GPoint& p2) const {
+	GPoint pts[] = {p0, p1, p2};
+	ctm.mapPoints(pts, pts, 3);
+	GRect r = GRect::LTRB(std::min({pts[0].x, pts[1].x, pts[2].x}), std::min({pts[0].y, pts[1].y, pts[2].y}),
+						  std::max({pts[0].x, pts[1].x, pts[2].x}), std::max({pts[0].y, pts[1].y, pts[2].y}));
+	// the tile only trims the blit, so a tile canvas would otherwise shade and scan convert
+	// every triangle of a mesh that crosses it
+	GIRect bounds = r.roundOut();
+	return !irectsIntersect(bounds, fClip.bounds()) || !irectsIntersect(bounds, fTile);
+}
+
 void MyCanvas::drawMeshColors(const GPoint verts[], const GColor colors[], int count, const int indices[]) {
 	int n = 0;
 	GPoint p0, p1, p2;
 	GColor c0, c1, c2;
-	std::shared_ptr<GShader> sh;
 	GPaint p;
 	for (int i=0; i<count; i++) {
 		p0 = verts[indices[n]];
 		p1 = verts[indices[n+1]];
 		p2 = verts[indices[n+2]];
+		if (this->quickRejectTriangle(p0, p1, p2)) {
+			n += 3;
+			continue;
+		}
 		c0 = colors[indices[n]];
 		c1 = colors[indices[n+1]];
 		c2 = colors[indices[n+2]];
-		sh = CreateTriColorShader(p0, p1, p2, c0, c1, c2);
-		p.setShader(sh);
+		// the triangle's shader and scratch are released before the next one
+		Arena::Mark mark = fArena.mark();
+		p.setShader(borrowShader(fArena.make<TriColorShader>(p0, p1, p2, c0, c1, c2)));
 		GPoint poly[] = {p0, p1, p2};
-		this->drawConvexPolygon(poly, 3, p);
+		this->fillConvexPolygon(poly, 3, p, nullptr);
+		fArena.rewind(mark);
 		n += 3;
 	}	
 }
@@ -1465,13 +1185,15 @@ void MyCanvas::drawMeshTexs(const GPoint verts[], const GPoint texs[], int count
 	GPoint p0, p1, p2;
 	GPoint tex0, tex1, tex2;
 	GMatrix P, T, invT;
-	std::shared_ptr<GShader> sh;
-	GPaint texPaint = paint;
 	GPaint p;
 	for (int i=0; i<count; i++) {
 		p0 = verts[indices[n]];
 		p1 = verts[indices[n+1]];
 		p2 = verts[indices[n+2]];
+		if (this->quickRejectTriangle(p0, p1, p2)) {
+			n += 3;
+			continue;
+		}
 		tex0 = texs[indices[n]];
 		tex1 = texs[indices[n+1]];
 		tex2 = texs[indices[n+2]];
@@ -1483,10 +1205,11 @@ void MyCanvas::drawMeshTexs(const GPoint verts[], const GPoint texs[], int count
 			invT = *invTPtr;
 		else
 			assert(false);
-		sh = CreateProxyShader(texPaint.peekShader(), P*invT);
-		p.setShader(sh);
+		Arena::Mark mark = fArena.mark();
+		p.setShader(borrowShader(fArena.make<ProxyShader>(paint.peekShader(), P*invT)));
 		GPoint poly[] = {p0, p1, p2};
-		this->drawConvexPolygon(poly, 3, p);
+		this->fillConvexPolygon(poly, 3, p, nullptr);
+		fArena.rewind(mark);
 		n += 3;
 	}	
 }
@@ -1498,21 +1221,24 @@ void MyCanvas::drawMeshColorsAndTexs(const GPoint verts[], const GColor colors[]
 	GColor c0, c1, c2;
 	GPoint tex0, tex1, tex2;
 	GMatrix P, T, invT;
-	std::shared_ptr<GShader> colorShader;
-	std::shared_ptr<GShader> texShader;
-	std::shared_ptr<GShader> doubleShader;
-	GPaint texPaint = paint;
 	GPaint p;
+	// one scratch row serves every triangle; they are drawn on this thread only
+	GPixel* scratch = fArena.makeArray<GPixel>(fDevice.width());
 	for (int i=0; i<count; i++) {
 		p0 = verts[indices[n]];
 		p1 = verts[indices[n+1]];
 		p2 = verts[indices[n+2]];
+		if (this->quickRejectTriangle(p0, p1, p2)) {
+			n += 3;
+			continue;
+		}
+		Arena::Mark mark = fArena.mark();
 
 		// make color shader
 		c0 = colors[indices[n]];
 		c1 = colors[indices[n+1]];
 		c2 = colors[indices[n+2]];
-		colorShader = CreateTriColorShader(p0, p1, p2, c0, c1, c2);
+		GShader* colorShader = fArena.make<TriColorShader>(p0, p1, p2, c0, c1, c2);
 
 		// make texture shader
 		tex0 = texs[indices[n]];
@@ -1525,22 +1251,25 @@ void MyCanvas::drawMeshColorsAndTexs(const GPoint verts[], const GColor colors[]
 			invT = *invTPtr;
 		else
 			assert(false);
-		texShader = CreateProxyShader(texPaint.peekShader(), P*invT);
+		GShader* texShader = fArena.make<ProxyShader>(paint.peekShader(), P*invT);
 
 		// make double shader
-		doubleShader = CreateDoubleShader(colorShader.get(), texShader.get());
-		p.setShader(doubleShader);
+		p.setShader(borrowShader(fArena.make<DoubleShader>(colorShader, texShader, scratch)));
 		GPoint poly[] = {p0, p1, p2};
-		this->drawConvexPolygon(poly, 3, p);
+		this->fillConvexPolygon(poly, 3, p, nullptr);
+		fArena.rewind(mark);
 		n += 3;
 	}	
 }
 
 void MyCanvas::drawMesh(const GPoint verts[], const GColor colors[], const GPoint texs[],
 						int count, const int indices[], const GPaint& paint) {
+	TraceScope trace(fTrace, &fTraceEvent, "drawMesh");
 	bool usingColors = colors != nullptr;
 	bool usingTexs = texs != nullptr;
-	GPaint p = paint;
+	if (fStats)
+		fStats->draws.mesh++;
+	fArena.reset();
 	if (usingColors && !usingTexs)
 		drawMeshColors(verts, colors, count, indices);
 	else if (!usingColors && usingTexs)
@@ -1648,15 +1377,15 @@ void MyCanvas::drawQuadLevel1(const GPoint verts[4], const GColor colors[4], con
 void MyCanvas::drawQuadColors(const GPoint verts[4], const GColor colors[4], int level) {
 	int totalLines = level + 2;
 	int numVertices = totalLines * totalLines;
-	GPoint newVerts[numVertices];
-	GColor newColors[numVertices];
+	GPoint* newVerts = fArena.makeArray<GPoint>(numVertices);
+	GColor* newColors = fArena.makeArray<GColor>(numVertices);
 	GColor a = colors[0];
 	GColor b = colors[1];
 	GColor c = colors[2];
 	GColor d = colors[3];
 	int denom = level + 1;
 	int numTriangles = denom*denom*2;
-	int indices[numTriangles*3];
+	int* indices = fArena.makeArray<int>(numTriangles*3);
 
 	float u = 0.0f;
 	float v = 0.0f;
@@ -1709,15 +1438,15 @@ void MyCanvas::drawQuadColors(const GPoint verts[4], const GColor colors[4], int
 void MyCanvas::drawQuadTexs(const GPoint verts[4], const GPoint texs[4], int level, const GPaint& paint) {
 	int totalLines = level + 2;
 	int numVertices = totalLines * totalLines;
-	GPoint newVerts[numVertices];
-	GPoint newTexs[numVertices];
+	GPoint* newVerts = fArena.makeArray<GPoint>(numVertices);
+	GPoint* newTexs = fArena.makeArray<GPoint>(numVertices);
 	GPoint a = texs[0];
 	GPoint b = texs[1];
 	GPoint c = texs[2];
 	GPoint d = texs[3];
 	int denom = level + 1;
 	int numTriangles = denom*denom*2;
-	int indices[numTriangles*3];
+	int* indices = fArena.makeArray<int>(numTriangles*3);
 
 	float u = 0.0f;
 	float v = 0.0f;
@@ -1770,9 +1499,9 @@ void MyCanvas::drawQuadTexs(const GPoint verts[4], const GPoint texs[4], int lev
 void MyCanvas::drawQuadColorsAndTexs(const GPoint verts[4], const GColor colors[4], const GPoint texs[4], int level, const GPaint& paint) {
 	int totalLines = level + 2;
 	int numVertices = totalLines * totalLines;
-	GPoint newVerts[numVertices];
-	GPoint newTexs[numVertices];
-	GColor newColors[numVertices];
+	GPoint* newVerts = fArena.makeArray<GPoint>(numVertices);
+	GPoint* newTexs = fArena.makeArray<GPoint>(numVertices);
+	GColor* newColors = fArena.makeArray<GColor>(numVertices);
 	GPoint ta = texs[0];
 	GPoint tb = texs[1];
 	GPoint tc = texs[2];
@@ -1783,7 +1512,7 @@ void MyCanvas::drawQuadColorsAndTexs(const GPoint verts[4], const GColor colors[
 	GColor cd = colors[3];
 	int denom = level + 1;
 	int numTriangles = denom*denom*2;
-	int indices[numTriangles*3];
+	int* indices = fArena.makeArray<int>(numTriangles*3);
 
 	float u = 0.0f;
 	float v = 0.0f;
@@ -1837,8 +1566,12 @@ void MyCanvas::drawQuadColorsAndTexs(const GPoint verts[4], const GColor colors[
 
 void MyCanvas::drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4],
 						int level, const GPaint& paint) {
+	TraceScope trace(fTrace, &fTraceEvent, "drawQuad");
 	bool usingColors = colors != nullptr;
 	bool usingTexs = texs != nullptr;
+	if (fStats)
+		fStats->draws.quad++;
+	fArena.reset();
 	if (usingColors && !usingTexs)
 		drawQuadColors(verts, colors, level);
 	else if (!usingColors && usingTexs)
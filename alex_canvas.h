@@ -12,14 +12,58 @@
 #include "include/GMatrix.h"
 #include "include/GPath.h"
 #include "include/GPathBuilder.h"
+#include "alex_arena.h"
+#include "alex_canvas_stats.h"
+#include "alex_canvas_trace.h"
+#include "alex_overdraw_map.h"
+#include "alex_region.h"
+#include "alex_render_context.h"
+#include "alex_path_cache.h"
+#include "alex_spans.h"
+
+// The pixels a canvas draws to. They may be only part of the device: pixels holds the rows and
+// columns from device pixel (originX, originY) on, in a device of size.
+class CanvasDevice {
+public:
+	explicit CanvasDevice(const GBitmap& pixels)
+		: CanvasDevice(pixels, 0, 0, {pixels.width(), pixels.height()}) {}
+	CanvasDevice(const GBitmap& pixels, int originX, int originY, GISize size)
+		: fPixels(pixels), fOriginX(originX), fOriginY(originY), fSize(size) {}
+
+	int width() const { return fSize.width; }
+	int height() const { return fSize.height; }
+	// true if every pixel of r is in memory (and so if r is empty)
+	bool holds(const GIRect& r) const {
+		return r.isEmpty() || (r.left >= fOriginX && r.top >= fOriginY &&
+							   r.right <= fOriginX + fPixels.width() && r.bottom <= fOriginY + fPixels.height());
+	}
+	GPixel* getAddr(int x, int y) const { return fPixels.getAddr(x - fOriginX, y - fOriginY); }
+
+private:
+	GBitmap fPixels;
+	int fOriginX, fOriginY;
+	GISize fSize;
+};
 
 class MyCanvas : public GCanvas {
 public:
-    MyCanvas(const GBitmap& device) : fDevice(device), ctm(GMatrix()) {}
+    MyCanvas(const GBitmap& device)
+		: MyCanvas(device, GIRect::WH(device.width(), device.height())) {}
+	// Draw only the pixels inside tile. Geometry, clips and shaders still work over the whole
+	// device, so those pixels come out exactly as an untiled canvas would draw them.
+	MyCanvas(const GBitmap& device, const GIRect& tile)
+		: MyCanvas(CanvasDevice(device), tile) {}
+	// As above; device must hold every pixel of tile.
+	MyCanvas(const CanvasDevice& device, const GIRect& tile)
+		: fDevice(device), ctm(GMatrix()), fClip(GIRect::WH(device.width(), device.height())), fTile(tile) {
+		assert(device.holds(tile));
+	}
 
 	void save() override;
 	void restore() override;
 	void concat(const GMatrix& matrix) override;
+	void clipRect(const GRect&) override;
+	void clipPath(const GPath&) override;
     void clear(const GColor& color) override;
 	void drawRect(const GRect&, const GPaint&) override;
 	void drawConvexPolygon(const GPoint[], int count, const GPaint&) override;
@@ -37,12 +81,66 @@ public:
 	void drawQuadColors(const GPoint verts[4], const GColor colors[4], int level);
 	void drawQuadTexs(const GPoint verts[4], const GPoint texs[4], int level, const GPaint&);
 	void drawQuadColorsAndTexs(const GPoint verts[4], const GColor colors[4], const GPoint texs[4], int level, const GPaint&);
+
+	// Scan convert geometry with the CTM into device-space spans, without drawing.
+	void rasterizeRect(const GRect&, SpanList*);
+	void rasterizeConvexPolygon(const GPoint[], int count, SpanList*);
+	void rasterizePath(const GPath&, SpanList*);
+	// Blit device-space spans with the paint (the CTM is only used by the paint's shader).
+	// The spans are clipped to the canvas clip.
+	void drawSpans(const SpanList&, const GPaint&);
+
+	// Blit tall draws in row bands on the context's pool (null, the default, draws on the
+	// calling thread only). Shaders must then be safe to shade rows from several threads.
+	void setRenderContext(RenderContext* context) { fContext = context; }
+
+	// Cache rasterized paths (0 = off). Cached paths snap their fractional translation
+	// to 1/kPathCacheSubpixel of a pixel.
+	void setPathCacheBudget(size_t bytes);
+	const PathCacheStats& pathCacheStats() const;
+
+	// Count what each draw does into stats (null, the default, counts nothing). The canvas
+	// only adds to stats; reset them to start over.
+	void setStats(CanvasStats* stats) { fStats = stats; }
+	// Record an event per call into trace (null, the default, records nothing).
+	void setTrace(CanvasTrace* trace) { fTrace = trace; }
+	// Count every pixel write into overdraw, which must be the device's size (null, the
+	// default, counts nothing).
+	void setOverdraw(OverdrawMap* overdraw) {
+		assert(!overdraw || (overdraw->width() == fDevice.width() && overdraw->height() == fDevice.height()));
+		fOverdraw = overdraw;
+	}
 	
 private:
     // Note: we store a copy of the bitmap
-    const GBitmap fDevice;
+    const CanvasDevice fDevice;
 	std::vector<GMatrix> matrix_stack;
 	GMatrix ctm;
+	// save() records the clip and a mark in fClipArena; restore() rewinds to the mark,
+	// releasing the clips made since
+	struct SavedClip {
+		GRegion clip;
+		Arena::Mark mark;
+	};
+	std::vector<SavedClip> clip_stack;
+	GRegion fClip;
+	Arena fClipArena;
+	GIRect fTile;	// pixels this canvas may write
+	PathCache fPathCache;
+	// Per-draw scratch, reset at the start of each draw: spans, edges, shade rows and the
+	// shaders meshes make per triangle. Once it has grown to fit, drawing stops calling malloc.
+	Arena fArena;
+	RenderContext* fContext = nullptr;
+	CanvasStats* fStats = nullptr;
+	CanvasTrace* fTrace = nullptr;
+	CanvasTrace::Event* fTraceEvent = nullptr;	// of the call in progress
+	OverdrawMap* fOverdraw = nullptr;
+
+	ThreadPool* bandPool() const { return fContext ? &fContext->pool() : nullptr; }
+	// drawConvexPolygon without resetting fArena, blitting in bands if pool is non-null
+	void fillConvexPolygon(const GPoint[], int count, const GPaint&, ThreadPool* pool);
+	// true if a triangle can't write any pixel this canvas may write, so it needs no shader
+	bool quickRejectTriangle(const GPoint& p0, const GPoint& p1, const GPoint& p2) const;
 };
 
 #endif
@@ -0,0 +1,130 @@
+#include "alex_canvas_stats.h"
+#include "alex_json.h"
+#include <cstdlib>
+#include <memory>
+
+#if defined(__GNUG__)
+	#include <cxxabi.h>
+#endif
+
+static const char* gModeNames[CanvasStats::kModeCount] = {
+	"clear", "src", "dst", "srcOver", "dstOver", "srcIn",
+	"dstIn", "srcOut", "dstOut", "srcATop", "dstATop", "xor",
+};
+
+std::string DemangledTypeName(const std::type_info& type) {
+#if defined(__GNUG__)
+	int status = 0;
+	std::unique_ptr<char, void(*)(void*)> name(abi::__cxa_demangle(type.name(), nullptr, nullptr, &status), std::free);
+	if (status == 0 && name)
+		return name.get();
+#endif
+	return type.name();
+}
+
+const char* BlendModeName(GBlendMode mode) {
+	return gModeNames[(int)mode];
+}
+
+CanvasStats::ShaderCounts* CanvasStats::shaderCounts(const GShader& shader) {
+	const std::type_info& type = typeid(shader);
+	for (ShaderCounts& s : shaders) {
+		if (*s.type == type)
+			return &s;
+	}
+	shaders.push_back({&type, DemangledTypeName(type)});
+	return &shaders.back();
+}
+
+void CanvasStats::add(const CanvasStats& o) {
+	draws.clear += o.draws.clear;
+	draws.rect += o.draws.rect;
+	draws.convexPolygon += o.draws.convexPolygon;
+	draws.path += o.draws.path;
+	draws.mesh += o.draws.mesh;
+	draws.quad += o.draws.quad;
+	draws.spans += o.draws.spans;
+	clearedPixels += o.clearedPixels;
+	edges += o.edges;
+	curveSegments += o.curveSegments;
+	for (int i=0; i<kModeCount; i++) {
+		spans[i] += o.spans[i];
+		pixels[i] += o.pixels[i];
+		for (int j=0; j<kModeCount; j++)
+			downgrades[i][j] += o.downgrades[i][j];
+	}
+	for (const ShaderCounts& s : o.shaders) {
+		ShaderCounts* mine = nullptr;
+		for (ShaderCounts& m : shaders) {
+			if (*m.type == *s.type)
+				mine = &m;
+		}
+		if (!mine) {
+			shaders.push_back({s.type, s.name});
+			mine = &shaders.back();
+		}
+		mine->draws += s.draws;
+		mine->shadeRows += s.shadeRows;
+		mine->pixels += s.pixels;
+	}
+}
+
+std::string CanvasStats::toJSON() const {
+	std::string out;
+	JSONWriter w(&out);
+	w.beginObject();
+
+	w.beginObject("draws");
+	w.value("clear", draws.clear);
+	w.value("rect", draws.rect);
+	w.value("convexPolygon", draws.convexPolygon);
+	w.value("path", draws.path);
+	w.value("mesh", draws.mesh);
+	w.value("quad", draws.quad);
+	w.value("spans", draws.spans);
+	w.endObject();
+
+	w.value("clearedPixels", clearedPixels);
+	w.value("edges", edges);
+	w.value("curveSegments", curveSegments);
+
+	w.beginObject("blit");
+	for (int i=0; i<kModeCount; i++) {
+		w.beginObject(gModeNames[i]);
+		w.value("spans", spans[i]);
+		w.value("pixels", pixels[i]);
+		w.endObject();
+	}
+	w.endObject();
+
+	// only the pairs taken, as "from": {"to": count}
+	w.beginObject("downgrades");
+	for (int i=0; i<kModeCount; i++) {
+		bool any = false;
+		for (int j=0; j<kModeCount; j++)
+			any |= downgrades[i][j] != 0;
+		if (!any)
+			continue;
+		w.beginObject(gModeNames[i]);
+		for (int j=0; j<kModeCount; j++) {
+			if (downgrades[i][j])
+				w.value(gModeNames[j], downgrades[i][j]);
+		}
+		w.endObject();
+	}
+	w.endObject();
+
+	w.beginArray("shaders");
+	for (const ShaderCounts& s : shaders) {
+		w.beginObject();
+		w.value("type", s.name);
+		w.value("draws", s.draws);
+		w.value("shadeRows", s.shadeRows);
+		w.value("pixels", s.pixels);
+		w.endObject();
+	}
+	w.endArray();
+
+	w.endObject();
+	return out;
+}
@@ -0,0 +1,65 @@
+#ifndef alex_canvas_stats_DEFINED
+#define alex_canvas_stats_DEFINED
+
+#include "include/GBlendMode.h"
+#include "include/GShader.h"
+#include <cstdint>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+/*
+ *  What a MyCanvas did while drawing, filled in after MyCanvas::setStats(). Counters are
+ *  only touched when stats are set, so the cost when off is a null check per draw and per
+ *  blitted row.
+ */
+struct CanvasStats {
+	static constexpr int kModeCount = (int)GBlendMode::kXor + 1;
+
+	// public draw calls, by primitive
+	struct Draws {
+		uint64_t clear = 0;
+		uint64_t rect = 0;
+		uint64_t convexPolygon = 0;
+		uint64_t path = 0;
+		uint64_t mesh = 0;
+		uint64_t quad = 0;
+		uint64_t spans = 0;		// drawSpans()
+	} draws;
+
+	uint64_t clearedPixels = 0;
+	uint64_t edges = 0;			// after clipping, for polygons and paths
+	uint64_t curveSegments = 0;	// lines quads and cubics were flattened into
+
+	// spans and pixels blitted, by the blend mode actually used
+	uint64_t spans[kModeCount] = {};
+	uint64_t pixels[kModeCount] = {};
+	// draws whose paint mode [from] was replaced by [to]; to = kDst means nothing was drawn
+	uint64_t downgrades[kModeCount][kModeCount] = {};
+
+	struct ShaderCounts {
+		const std::type_info* type;
+		std::string name;
+		uint64_t draws = 0;
+		uint64_t shadeRows = 0;
+		uint64_t pixels = 0;	// shaded, which can exceed those blitted when a tile cuts a span
+	};
+	// one entry per shader class seen, in the order first drawn
+	std::vector<ShaderCounts> shaders;
+
+	// The entry for shader's class, added if this is the first of its kind.
+	ShaderCounts* shaderCounts(const GShader& shader);
+
+	void add(const CanvasStats&);
+	void reset() { *this = CanvasStats(); }
+
+	// Every counter as one JSON object; downgrades lists only the pairs taken.
+	std::string toJSON() const;
+};
+
+// "srcOver" for GBlendMode::kSrcOver, and so on
+const char* BlendModeName(GBlendMode);
+// the class name as written in source, where the compiler can demangle it
+std::string DemangledTypeName(const std::type_info&);
+
+#endif
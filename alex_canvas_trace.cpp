@@ -0,0 +1,57 @@
+#include "alex_canvas_trace.h"
+#include "alex_canvas_stats.h"
+#include "alex_json.h"
+#include <cstdio>
+#include <cstring>
+
+void CanvasTrace::reset() {
+	fEvents.clear();
+	fOrigin = GTime::GetNSec();
+}
+
+std::string CanvasTrace::toJSON() const {
+	std::string out;
+	JSONWriter w(&out);
+	w.beginObject();
+	w.beginArray("traceEvents");
+	for (const Event& e : fEvents) {
+		// "X" is a complete event: a start and a duration
+		w.beginObject();
+		w.value("name", e.name);
+		w.value("cat", strncmp(e.name, "clip", 4) ? "draw" : "clip");
+		w.value("ph", "X");
+		w.value("ts", (double)(e.begin - fOrigin) / 1000);
+		w.value("dur", (double)(e.end - e.begin) / 1000);
+		w.value("pid", 1);
+		w.value("tid", 1);
+		w.beginObject("args");
+		w.value("pixels", e.pixels);
+		if (e.pixels > 0) {
+			w.beginArray("bounds");
+			w.value(nullptr, e.bounds.left);
+			w.value(nullptr, e.bounds.top);
+			w.value(nullptr, e.bounds.right);
+			w.value(nullptr, e.bounds.bottom);
+			w.endArray();
+		}
+		if (e.mode >= 0)
+			w.value("mode", BlendModeName((GBlendMode)e.mode));
+		if (e.shader)
+			w.value("shader", DemangledTypeName(*e.shader));
+		w.endObject();
+		w.endObject();
+	}
+	w.endArray();
+	w.value("displayTimeUnit", "ns");
+	w.endObject();
+	return out;
+}
+
+bool CanvasTrace::writeJSON(const char path[]) const {
+	FILE* f = fopen(path, "wb");
+	if (!f)
+		return false;
+	std::string json = this->toJSON();
+	bool ok = fwrite(json.data(), 1, json.size(), f) == json.size();
+	return fclose(f) == 0 && ok;
+}
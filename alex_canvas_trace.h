@@ -0,0 +1,48 @@
+#ifndef alex_canvas_trace_DEFINED
+#define alex_canvas_trace_DEFINED
+
+#include "include/GRect.h"
+#include "include/GTime.h"
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+/*
+ *  A timeline of the GCanvas calls made on a MyCanvas, filled in after MyCanvas::setTrace()
+ *  and written as Chrome trace-event JSON, which chrome://tracing and Perfetto open. A trace
+ *  is recorded from one thread.
+ */
+class CanvasTrace {
+public:
+	struct Event {
+		const char* name;						// the call, e.g. "drawPath"
+		GNSec begin;
+		GNSec end = 0;
+		GIRect bounds = GIRect::LTRB(0, 0, 0, 0);	// of the pixels written
+		uint64_t pixels = 0;
+		int mode = -1;							// GBlendMode blitted with, or -1 if none
+		const std::type_info* shader = nullptr;
+	};
+
+	CanvasTrace() : fOrigin(GTime::GetNSec()) {}
+
+	// Start an event now. It stays valid until the next call to begin().
+	Event* begin(const char name[]) {
+		fEvents.push_back({name, GTime::GetNSec()});
+		return &fEvents.back();
+	}
+
+	const std::vector<Event>& events() const { return fEvents; }
+	// drop the events and restart the clock
+	void reset();
+
+	// Times are in microseconds from construction or the last reset().
+	std::string toJSON() const;
+	bool writeJSON(const char path[]) const;
+
+private:
+	std::vector<Event> fEvents;
+	GNSec fOrigin;
+};
+
+#endif
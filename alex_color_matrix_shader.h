@@ -34,30 +34,40 @@ GColor multiplyColorMatrix(GColorMatrix M, GColor old) {
 class MyColorMatrixShader : public GShader {
 private:
 	GShader* fRealShader;
+	std::shared_ptr<GShader> fRealOwner;	// keeps a ref-counted realShader alive (e.g. when recorded)
 	GColorMatrix fMatrix;
 
 public:
 	MyColorMatrixShader(const GColorMatrix& matrix, GShader* realShader) {
 		fMatrix = matrix;
 		fRealShader = realShader;
+		fRealOwner = realShader->weak_from_this().lock();
 	}
 
     bool isOpaque() override { return fRealShader->isOpaque(); }
 
+	// copies the real shader too, which the copy then owns
+	std::shared_ptr<GShader> makeCopy() const override {
+		std::shared_ptr<GShader> real = fRealShader->makeCopy();
+		if (!real)
+			return nullptr;
+		return std::make_shared<MyColorMatrixShader>(fMatrix, real.get());
+	}
+
     bool setContext(const GMatrix& ctm) override {
 		return fRealShader->setContext(ctm);
     }
     
     void shadeRow(int x, int y, int count, GPixel row[]) override {
-		GPixel rowBuffer[count];
-		fRealShader->shadeRow(x, y, count, rowBuffer);
+		// filter in place, so wide rows need no buffer of their own
+		fRealShader->shadeRow(x, y, count, row);
 		for (int i=0; i<count; i++) {
-			GPixel pixel = rowBuffer[i];
+			GPixel pixel = row[i];
 			if (GPixel_GetA(pixel) == 0) {
 				row[i] = 0;
 				continue;
 			}
-			GColor oldColor = makeColorFromPixel(rowBuffer[i]);
+			GColor oldColor = makeColorFromPixel(pixel);
 			GColor color = multiplyColorMatrix(fMatrix, oldColor);
 			if (color.a == 0.0f) {
 				row[i] = 0;
@@ -65,7 +75,6 @@ public:
 			}
 			pixel = makePixelFromColor(color);
 			row[i] = pixel;
-			// row[i] = rowBuffer[i];
 		}
     }
 };
@@ -6,9 +6,11 @@
 class DoubleShader : public GShader {
     GShader* shader1;
 	GShader* shader2;
+	GPixel* scratch;	// holds shader2's row; shared, so rows are shaded one at a time
 public:
-    DoubleShader(GShader* shader1, GShader* shader2)
-        : shader1(shader1), shader2(shader2) {}
+	// scratch must hold the longest row that will be shaded (e.g. the device width)
+    DoubleShader(GShader* shader1, GShader* shader2, GPixel scratch[])
+        : shader1(shader1), shader2(shader2), scratch(scratch) {}
 
     bool isOpaque() override {
 		return shader1->isOpaque() && shader2->isOpaque();
@@ -19,19 +21,12 @@ public:
     }
     
     void shadeRow(int x, int y, int count, GPixel row[]) override {
-		GPixel row1[count];
-		GPixel row2[count];
-        shader1->shadeRow(x, y, count, row1);
-        shader2->shadeRow(x, y, count, row2);
+        shader1->shadeRow(x, y, count, row);
+        shader2->shadeRow(x, y, count, scratch);
 		//TODO: add opaque version
 		for (int i=0; i<count; i++)
-			row[i] = modulateBlend(row1[i], row2[i]);
-			// row[i] = row1[i];
+			row[i] = modulateBlend(row[i], scratch[i]);
     }
 };
 
-std::shared_ptr<GShader> CreateDoubleShader(GShader* shader1, GShader* shader2) {
-	return std::make_shared<DoubleShader>(shader1, shader2);
-}
-
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,178 @@
+#include "alex_image_diff.h"
+#include "alex_render_context.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+static inline int absDiff(unsigned a, unsigned b) {
+	return a > b ? a - b : b - a;
+}
+
+// Each row loop writes the differences to dst, counts the pixels that are 0 in both rows into
+// *clear, and returns how many pixels it did: the vector ones go 4 (SSE2) or 8 (AVX2) at a time.
+
+static int diffScalar(uint8_t dst[], const GPixel a[], const GPixel b[], int count, uint64_t* clear) {
+	for (int i=0; i<count; i++) {
+		int d = std::max(std::max(absDiff(GPixel_GetA(a[i]), GPixel_GetA(b[i])),
+								  absDiff(GPixel_GetR(a[i]), GPixel_GetR(b[i]))),
+						 std::max(absDiff(GPixel_GetG(a[i]), GPixel_GetG(b[i])),
+								  absDiff(GPixel_GetB(a[i]), GPixel_GetB(b[i]))));
+		dst[i] = (uint8_t)d;
+		*clear += (a[i] | b[i]) == 0;
+	}
+	return count;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+// largest byte of each 32-bit lane of |a - b|, in the lane's low byte
+static inline __m128i laneMaxDiff(__m128i a, __m128i b) {
+	__m128i d = _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+	d = _mm_max_epu8(d, _mm_srli_epi32(d, 8));
+	d = _mm_max_epu8(d, _mm_srli_epi32(d, 16));
+	return _mm_and_si128(d, _mm_set1_epi32(0xFF));
+}
+
+static int diffSSE2(uint8_t dst[], const GPixel a[], const GPixel b[], int count, uint64_t* clear) {
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+		__m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+		__m128i zero = _mm_setzero_si128();
+		int clearMask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_or_si128(va, vb), zero)));
+		*clear += __builtin_popcount(clearMask);
+		__m128i d = laneMaxDiff(va, vb);
+		d = _mm_packus_epi16(_mm_packs_epi32(d, d), zero);
+		int bytes = _mm_cvtsi128_si32(d);
+		memcpy(dst + i, &bytes, 4);
+	}
+	return i;
+}
+
+__attribute__((target("avx2")))
+static int diffAVX2(uint8_t dst[], const GPixel a[], const GPixel b[], int count, uint64_t* clear) {
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+		__m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+		__m256i zero = _mm256_setzero_si256();
+		__m256i either = _mm256_or_si256(va, vb);
+		if (_mm256_testz_si256(either, either)) {
+			*clear += 8;
+			memset(dst + i, 0, 8);
+			continue;
+		}
+		int clearMask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(either, zero)));
+		*clear += __builtin_popcount(clearMask);
+		__m256i d = _mm256_or_si256(_mm256_subs_epu8(va, vb), _mm256_subs_epu8(vb, va));
+		d = _mm256_max_epu8(d, _mm256_srli_epi32(d, 8));
+		d = _mm256_max_epu8(d, _mm256_srli_epi32(d, 16));
+		d = _mm256_and_si256(d, _mm256_set1_epi32(0xFF));
+		// packs work within 128-bit halves: pixels 0-3 end up in the low half, 4-7 in the high
+		d = _mm256_packus_epi16(_mm256_packs_epi32(d, d), zero);
+		int lo = _mm_cvtsi128_si32(_mm256_castsi256_si128(d));
+		int hi = _mm_cvtsi128_si32(_mm256_extracti128_si256(d, 1));
+		memcpy(dst + i, &lo, 4);
+		memcpy(dst + i + 4, &hi, 4);
+	}
+	return i;
+}
+
+static bool hasAVX2() {
+	static const bool avx2 = __builtin_cpu_supports("avx2");
+	return avx2;
+}
+#endif
+
+// PixelDiffRow, also counting pixels 0 in both rows into *clear
+static void diffRow(uint8_t dst[], const GPixel a[], const GPixel b[], int count, uint64_t* clear) {
+	int done = 0;
+#if defined(__x86_64__) || defined(__i386__)
+	if (count >= 8 && hasAVX2())
+		done = diffAVX2(dst, a, b, count, clear);
+	done += diffSSE2(dst + done, a + done, b + done, count - done, clear);
+#endif
+	diffScalar(dst + done, a + done, b + done, count - done, clear);
+}
+
+void PixelDiffRow(uint8_t dst[], const GPixel a[], const GPixel b[], int count) {
+	uint64_t clear = 0;
+	diffRow(dst, a, b, count, &clear);
+}
+
+int ImageDiff::maxDiff(int tolerance) const {
+	for (int d=255; d>tolerance; d--) {
+		if (histogram[d])
+			return d - tolerance;
+	}
+	return 0;
+}
+
+uint64_t ImageDiff::totalDiff(int tolerance) const {
+	uint64_t total = 0;
+	for (int d=std::max(tolerance + 1, 1); d<256; d++)
+		total += histogram[d] * (d - tolerance);
+	return total;
+}
+
+void ImageDiff::add(const ImageDiff& o) {
+	pixels += o.pixels;
+	bothClear += o.bothClear;
+	for (int i=0; i<256; i++)
+		histogram[i] += o.histogram[i];
+}
+
+// Add rows [top, bottom) to diff.
+static void compareRows(const GBitmap& a, const GBitmap& b, int top, int bottom, ImageDiff* diff) {
+	constexpr int kChunk = 512;
+	uint8_t diffs[kChunk];
+	// split across 4 tables, so runs of one value don't wait on each other's increments
+	uint64_t histograms[4][256] = {};
+	uint64_t clear = 0;
+	for (int y=top; y<bottom; y++) {
+		const GPixel* rowA = a.getAddr(0, y);
+		const GPixel* rowB = b.getAddr(0, y);
+		for (int x=0; x<a.width(); x+=kChunk) {
+			int n = std::min(kChunk, a.width() - x);
+			diffRow(diffs, rowA + x, rowB + x, n, &clear);
+			int i = 0;
+			for (; i + 8 <= n; i += 8) {
+				uint64_t eight;
+				memcpy(&eight, diffs + i, 8);
+				if (eight == 0) {
+					histograms[0][0] += 8;
+					continue;
+				}
+				for (int j=0; j<8; j++)
+					histograms[j & 3][diffs[i + j]]++;
+			}
+			for (; i<n; i++)
+				histograms[0][diffs[i]]++;
+		}
+	}
+	for (int d=0; d<256; d++)
+		diff->histogram[d] += histograms[0][d] + histograms[1][d] + histograms[2][d] + histograms[3][d];
+	// pixels clear in both were counted at 0 with the rest
+	diff->histogram[0] -= clear;
+	diff->bothClear += clear;
+	diff->pixels += (uint64_t)(bottom - top) * a.width();
+}
+
+ImageDiff CompareBitmaps(const GBitmap& a, const GBitmap& b, RenderContext* context) {
+	ImageDiff diff;
+	if (a.width() != b.width() || a.height() != b.height())
+		return diff;
+	if (!context)
+		context = RenderContext::Default();
+	std::mutex mutex;
+	// bands of at least 256K pixels
+	int grain = std::max(1, (256 << 10) / std::max(1, a.width()));
+	context->pool().parallelForRanges(0, a.height(), grain, [&](int top, int bottom) {
+		ImageDiff band;
+		compareRows(a, b, top, bottom, &band);
+		std::lock_guard<std::mutex> lock(mutex);
+		diff.add(band);
+	});
+	return diff;
+}
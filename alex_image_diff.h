@@ -0,0 +1,35 @@
+#ifndef alex_image_diff_DEFINED
+#define alex_image_diff_DEFINED
+
+#include "include/GBitmap.h"
+#include <cstdint>
+
+class RenderContext;
+
+/*
+ *  Pixel comparison of two bitmaps by the largest difference of any one channel, the
+ *  measure the image tool scores with.
+ */
+
+// dst[i] = largest channel difference between a[i] and b[i]
+void PixelDiffRow(uint8_t dst[], const GPixel a[], const GPixel b[], int count);
+
+struct ImageDiff {
+	uint64_t pixels = 0;
+	uint64_t bothClear = 0;			// 0 in both bitmaps, left out of the histogram
+	uint64_t histogram[256] = {};	// the other pixels, by their difference
+
+	uint64_t scored() const { return pixels - bothClear; }
+	// largest and total of the differences above tolerance, less the tolerance
+	int maxDiff(int tolerance = 0) const;
+	uint64_t totalDiff(int tolerance = 0) const;
+
+	void add(const ImageDiff&);
+};
+
+// Compare bitmaps of the same size, bands of rows at once on context's pool
+// (RenderContext::Default() if null). Every count is exact, so the result never depends on
+// how the rows were split.
+ImageDiff CompareBitmaps(const GBitmap& a, const GBitmap& b, RenderContext* context = nullptr);
+
+#endif
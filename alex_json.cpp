@@ -0,0 +1,211 @@
+#include "alex_json.h"
+#include <cstdlib>
+#include <cstring>
+
+const JSONValue* JSONValue::find(const char key[]) const {
+	if (type != Type::kObject)
+		return nullptr;
+	for (size_t i=0; i<keys.size(); i++) {
+		if (keys[i] == key)
+			return &elements[i];
+	}
+	return nullptr;
+}
+
+double JSONValue::numberAt(const char key[], double fallback) const {
+	const JSONValue* v = this->find(key);
+	return v && v->type == Type::kNumber ? v->number : fallback;
+}
+
+std::string JSONValue::stringAt(const char key[], const char fallback[]) const {
+	const JSONValue* v = this->find(key);
+	return v && v->type == Type::kString ? v->string : fallback;
+}
+
+namespace {
+// Recursive descent over text; every parse method skips the whitespace before its value.
+class JSONParser {
+public:
+	explicit JSONParser(const std::string& text) : fCur(text.c_str()), fEnd(text.c_str() + text.size()) {}
+
+	bool parseDocument(JSONValue* value) {
+		if (!this->parseValue(value, 0))
+			return false;
+		this->skipSpace();
+		return fCur == fEnd;
+	}
+
+private:
+	const char* fCur;
+	const char* fEnd;
+
+	// deeper documents are rejected rather than risking the stack
+	static constexpr int kMaxDepth = 64;
+
+	void skipSpace() {
+		while (fCur < fEnd && (*fCur == ' ' || *fCur == '\t' || *fCur == '\n' || *fCur == '\r'))
+			fCur++;
+	}
+
+	bool match(const char word[]) {
+		size_t n = strlen(word);
+		if ((size_t)(fEnd - fCur) < n || strncmp(fCur, word, n))
+			return false;
+		fCur += n;
+		return true;
+	}
+
+	bool parseValue(JSONValue* value, int depth) {
+		this->skipSpace();
+		if (fCur == fEnd || depth > kMaxDepth)
+			return false;
+		switch (*fCur) {
+			case '{':
+				return this->parseObject(value, depth);
+			case '[':
+				return this->parseArray(value, depth);
+			case '"':
+				value->type = JSONValue::Type::kString;
+				return this->parseString(&value->string);
+			case 't':
+				value->type = JSONValue::Type::kBool;
+				value->boolean = true;
+				return this->match("true");
+			case 'f':
+				value->type = JSONValue::Type::kBool;
+				value->boolean = false;
+				return this->match("false");
+			case 'n':
+				value->type = JSONValue::Type::kNull;
+				return this->match("null");
+			default:
+				return this->parseNumber(value);
+		}
+	}
+
+	bool parseNumber(JSONValue* value) {
+		// strtod stops at the terminating nul the std::string guarantees
+		char* end;
+		value->number = strtod(fCur, &end);
+		if (end == fCur || end > fEnd)
+			return false;
+		value->type = JSONValue::Type::kNumber;
+		fCur = end;
+		return true;
+	}
+
+	void appendUTF8(std::string* s, unsigned c) {
+		if (c < 0x80) {
+			*s += (char)c;
+		} else if (c < 0x800) {
+			*s += (char)(0xC0 | (c >> 6));
+			*s += (char)(0x80 | (c & 0x3F));
+		} else {
+			*s += (char)(0xE0 | (c >> 12));
+			*s += (char)(0x80 | ((c >> 6) & 0x3F));
+			*s += (char)(0x80 | (c & 0x3F));
+		}
+	}
+
+	bool parseString(std::string* s) {
+		fCur++;		// the opening quote
+		s->clear();
+		while (fCur < fEnd && *fCur != '"') {
+			char c = *fCur++;
+			if (c != '\\') {
+				*s += c;
+				continue;
+			}
+			if (fCur == fEnd)
+				return false;
+			switch (c = *fCur++) {
+				case '"': case '\\': case '/': *s += c; break;
+				case 'b': *s += '\b'; break;
+				case 'f': *s += '\f'; break;
+				case 'n': *s += '\n'; break;
+				case 'r': *s += '\r'; break;
+				case 't': *s += '\t'; break;
+				case 'u': {
+					if (fEnd - fCur < 4)
+						return false;
+					char hex[5] = {fCur[0], fCur[1], fCur[2], fCur[3], 0};
+					char* end;
+					unsigned code = (unsigned)strtoul(hex, &end, 16);
+					if (end != hex + 4)
+						return false;
+					// surrogate pairs are kept as two code points
+					this->appendUTF8(s, code);
+					fCur += 4;
+					break;
+				}
+				default:
+					return false;
+			}
+		}
+		if (fCur == fEnd)
+			return false;
+		fCur++;		// the closing quote
+		return true;
+	}
+
+	bool parseArray(JSONValue* value, int depth) {
+		fCur++;
+		value->type = JSONValue::Type::kArray;
+		this->skipSpace();
+		if (fCur < fEnd && *fCur == ']') {
+			fCur++;
+			return true;
+		}
+		for (;;) {
+			value->elements.emplace_back();
+			if (!this->parseValue(&value->elements.back(), depth + 1))
+				return false;
+			this->skipSpace();
+			if (fCur == fEnd)
+				return false;
+			char c = *fCur++;
+			if (c == ']')
+				return true;
+			if (c != ',')
+				return false;
+		}
+	}
+
+	bool parseObject(JSONValue* value, int depth) {
+		fCur++;
+		value->type = JSONValue::Type::kObject;
+		this->skipSpace();
+		if (fCur < fEnd && *fCur == '}') {
+			fCur++;
+			return true;
+		}
+		for (;;) {
+			this->skipSpace();
+			if (fCur == fEnd || *fCur != '"')
+				return false;
+			value->keys.emplace_back();
+			if (!this->parseString(&value->keys.back()))
+				return false;
+			this->skipSpace();
+			if (fCur == fEnd || *fCur++ != ':')
+				return false;
+			value->elements.emplace_back();
+			if (!this->parseValue(&value->elements.back(), depth + 1))
+				return false;
+			this->skipSpace();
+			if (fCur == fEnd)
+				return false;
+			char c = *fCur++;
+			if (c == '}')
+				return true;
+			if (c != ',')
+				return false;
+		}
+	}
+};
+}
+
+bool ParseJSON(const std::string& text, JSONValue* value) {
+	*value = JSONValue();
+	return JSONParser(text).parseDocument(value);
+}
@@ -0,0 +1,124 @@
+#ifndef alex_json_DEFINED
+#define alex_json_DEFINED
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/*
+ *  Appends JSON to a string as it is written, with no tree in between. Members take a key,
+ *  array elements pass null; separators are added as needed. Nothing checks that begins and
+ *  ends pair up.
+ */
+class JSONWriter {
+public:
+	explicit JSONWriter(std::string* out) : fOut(out) {}
+
+	void beginObject(const char key[] = nullptr) {
+		this->key(key);
+		*fOut += '{';
+		fFirst = true;
+	}
+	void endObject() {
+		*fOut += '}';
+		fFirst = false;
+	}
+	void beginArray(const char key[] = nullptr) {
+		this->key(key);
+		*fOut += '[';
+		fFirst = true;
+	}
+	void endArray() {
+		*fOut += ']';
+		fFirst = false;
+	}
+
+	void value(const char key[], bool v) {
+		this->key(key);
+		*fOut += v ? "true" : "false";
+	}
+	void value(const char key[], int v) {
+		this->key(key);
+		*fOut += std::to_string(v);
+	}
+	void value(const char key[], uint64_t v) {
+		this->key(key);
+		*fOut += std::to_string(v);
+	}
+	// to three decimal places
+	void value(const char key[], double v) {
+		char buffer[64];
+		snprintf(buffer, sizeof(buffer), "%.3f", v);
+		this->key(key);
+		*fOut += buffer;
+	}
+	void value(const char key[], const char v[]) {
+		this->key(key);
+		this->string(v);
+	}
+	void value(const char key[], const std::string& v) {
+		this->value(key, v.c_str());
+	}
+
+private:
+	std::string* fOut;
+	bool fFirst = true;
+
+	void key(const char key[]) {
+		if (!fFirst)
+			*fOut += ',';
+		fFirst = false;
+		if (key) {
+			this->string(key);
+			*fOut += ':';
+		}
+	}
+
+	void string(const char s[]) {
+		*fOut += '"';
+		for (; *s; s++) {
+			unsigned char c = *s;
+			if (c == '"' || c == '\\') {
+				*fOut += '\\';
+				*fOut += c;
+			} else if (c < 0x20) {
+				char escape[8];
+				snprintf(escape, sizeof(escape), "\\u%04x", c);
+				*fOut += escape;
+			} else {
+				*fOut += c;
+			}
+		}
+		*fOut += '"';
+	}
+};
+
+/*
+ *  A parsed JSON document, enough to read back what JSONWriter writes. Objects keep their
+ *  members in order, as keys[i] naming elements[i]. Numbers are read by strtod, which lets
+ *  through a few forms JSON does not have (hex, inf).
+ */
+struct JSONValue {
+	enum class Type { kNull, kBool, kNumber, kString, kArray, kObject };
+
+	Type type = Type::kNull;
+	bool boolean = false;
+	double number = 0;
+	std::string string;
+	std::vector<std::string> keys;		// objects only
+	std::vector<JSONValue> elements;	// array elements or member values
+
+	// The member named key, or null if there is none or this is not an object.
+	const JSONValue* find(const char key[]) const;
+	// The member's number, or fallback if it is missing or not a number.
+	double numberAt(const char key[], double fallback) const;
+	// The member's string, or fallback if it is missing or not a string.
+	std::string stringAt(const char key[], const char fallback[]) const;
+};
+
+// Parse all of text into *value, returning false (and leaving *value unspecified) if it is
+// not a single well formed JSON value.
+bool ParseJSON(const std::string& text, JSONValue* value);
+
+#endif
@@ -74,6 +74,9 @@ public:
 	bool isOpaque() override {
 		return fOpaque;
 	}
+	std::shared_ptr<GShader> makeCopy() const override {
+		return std::make_shared<LinearPosGradient>(*this);
+	}
 
 	bool setContext(const GMatrix& ctm) override {
 		if (auto inv = (ctm * m).invert()) {
@@ -3,61 +3,185 @@
 GMatrix::GMatrix() {
 	fMat[0] = 1;	fMat[2] = 0;	fMat[4] = 0;
 	fMat[1] = 0;	fMat[3] = 1;	fMat[5] = 0;
+	fTypeMask = kIdentity_Mask;
 }
 
 GMatrix GMatrix::Translate(float tx, float ty) {
-	GMatrix m;
-	m[0] = 1;	m[2] = 0;	m[4] = tx;
-	m[1] = 0;	m[3] = 1;	m[5] = ty;
-	return m;
+	return GMatrix(1, 0, tx,
+				   0, 1, ty);
 }
 
 GMatrix GMatrix::Scale(float sx, float sy) {
-	GMatrix m;
-	m[0] = sx;	m[2] = 0;	m[4] = 0;
-	m[1] = 0;	m[3] = sy;	m[5] = 0;
-	return m;
+	return GMatrix(sx, 0, 0,
+				   0, sy, 0);
 }
 
 GMatrix GMatrix::Rotate(float radians) {
-	GMatrix m;
-	m[0] = std::cos(radians);	m[2] = -std::sin(radians);	m[4] = 0;
-	m[1] = std::sin(radians);	m[3] = std::cos(radians);	m[5] = 0;
-	return m;
+	return GMatrix(std::cos(radians), -std::sin(radians), 0,
+				   std::sin(radians), std::cos(radians), 0);
 }
 
 GMatrix GMatrix::Concat(const GMatrix& a, const GMatrix& b) {
-	GMatrix m;
-	m[0] = a[0] * b[0] + a[2] * b[1];
-	m[1] = a[1] * b[0] + a[3] * b[1];
-	m[2] = a[0] * b[2] + a[2] * b[3];
-	m[3] = a[1] * b[2] + a[3] * b[3];
-	m[4] = a[0] * b[4] + a[2] * b[5] + a[4];
-	m[5] = a[1] * b[4] + a[3] * b[5] + a[5];
-	return m;
+	unsigned typeA = a.getType();
+	unsigned typeB = b.getType();
+	if (typeA == kIdentity_Mask)
+		return b;
+	if (typeB == kIdentity_Mask)
+		return a;
+
+	if (!((typeA | typeB) & kAffine_Mask)) {
+		// both scale + translate: the skew terms stay zero
+		return GMatrix(a[0] * b[0], 0, a[0] * b[4] + a[4],
+					   0, a[3] * b[3], a[3] * b[5] + a[5]);
+	}
+	return GMatrix(a[0] * b[0] + a[2] * b[1], a[0] * b[2] + a[2] * b[3], a[0] * b[4] + a[2] * b[5] + a[4],
+				   a[1] * b[0] + a[3] * b[1], a[1] * b[2] + a[3] * b[3], a[1] * b[4] + a[3] * b[5] + a[5]);
 }
 
 nonstd::optional<GMatrix> GMatrix::invert() const {
+	unsigned type = this->getType();
+	if (type == kIdentity_Mask)
+		return *this;
+	if (type == kTranslate_Mask)
+		return Translate(-fMat[4], -fMat[5]);
+
 	float det = fMat[0] * fMat[3] - fMat[2] * fMat[1];
 	if (det == 0.0f)
 		return nonstd::nullopt;
 
-	GMatrix m;
 	float invDet = 1.0f / det;
 	float a = fMat[0], b = fMat[1], c = fMat[2], d = fMat[3], e = fMat[4], f = fMat[5];
-	m[0] = d * invDet;
-	m[1] = -b * invDet;
-	m[2] = -c * invDet;
-	m[3] = a * invDet;
-	m[4] = (c * f - d * e) * invDet;
-	m[5] = (b * e - a * f) * invDet;
-	return m;
+	return GMatrix(d * invDet, -c * invDet, (c * f - d * e) * invDet,
+				   -b * invDet, a * invDet, (b * e - a * f) * invDet);
+}
+
+/*
+ *  Point mapping kernels. GPoints are interleaved x,y floats, so one vector maps several points:
+ *
+ *  [x' y'] = [x y] * [a d] + [y x] * [c b] + [e f]
+ *
+ *  Each lane does the same multiplies and adds in the same order as the scalar code (FMA is
+ *  never enabled), so every path gives bit-identical results. Loads come before stores, so dst
+ *  may equal src.
+ */
+struct MapCoeffs {
+	float mul[2];	// a, d
+	float cross[2];	// c, b (unused for scale + translate)
+	float add[2];	// e, f
+};
+
+static void mapInterleavedScalar(float dst[], const float src[], int points, const MapCoeffs& k, bool cross) {
+	for (int i=0; i<points; i++) {
+		float x = src[2*i];
+		float y = src[2*i + 1];
+		if (cross) {
+			dst[2*i] = (x * k.mul[0] + y * k.cross[0]) + k.add[0];
+			dst[2*i + 1] = (y * k.mul[1] + x * k.cross[1]) + k.add[1];
+		} else {
+			dst[2*i] = x * k.mul[0] + k.add[0];
+			dst[2*i + 1] = y * k.mul[1] + k.add[1];
+		}
+	}
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+// 2 points per vector; SSE2 is always available on x86-64
+static int mapInterleavedSSE2(float dst[], const float src[], int points, const MapCoeffs& k, bool cross) {
+	__m128 mul = _mm_setr_ps(k.mul[0], k.mul[1], k.mul[0], k.mul[1]);
+	__m128 crs = _mm_setr_ps(k.cross[0], k.cross[1], k.cross[0], k.cross[1]);
+	__m128 add = _mm_setr_ps(k.add[0], k.add[1], k.add[0], k.add[1]);
+	int i = 0;
+	for (; i + 2 <= points; i += 2) {
+		__m128 v = _mm_loadu_ps(src + 2*i);
+		__m128 r = _mm_mul_ps(v, mul);
+		if (cross) {
+			__m128 swapped = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+			r = _mm_add_ps(r, _mm_mul_ps(swapped, crs));
+		}
+		_mm_storeu_ps(dst + 2*i, _mm_add_ps(r, add));
+	}
+	return i;
+}
+
+__attribute__((target("avx2")))
+static inline __m256 map4AVX2(__m256 v, __m256 mul, __m256 crs, __m256 add, bool cross) {
+	__m256 r = _mm256_mul_ps(v, mul);
+	if (cross)
+		r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_permute_ps(v, 0xB1), crs));
+	return _mm256_add_ps(r, add);
+}
+
+// 8 points per iteration, then 4
+__attribute__((target("avx2")))
+static int mapInterleavedAVX2(float dst[], const float src[], int points, const MapCoeffs& k, bool cross) {
+	__m256 mul = _mm256_setr_ps(k.mul[0], k.mul[1], k.mul[0], k.mul[1], k.mul[0], k.mul[1], k.mul[0], k.mul[1]);
+	__m256 crs = _mm256_setr_ps(k.cross[0], k.cross[1], k.cross[0], k.cross[1],
+								k.cross[0], k.cross[1], k.cross[0], k.cross[1]);
+	__m256 add = _mm256_setr_ps(k.add[0], k.add[1], k.add[0], k.add[1], k.add[0], k.add[1], k.add[0], k.add[1]);
+	int i = 0;
+	for (; i + 8 <= points; i += 8) {
+		__m256 v0 = _mm256_loadu_ps(src + 2*i);
+		__m256 v1 = _mm256_loadu_ps(src + 2*i + 8);
+		_mm256_storeu_ps(dst + 2*i, map4AVX2(v0, mul, crs, add, cross));
+		_mm256_storeu_ps(dst + 2*i + 8, map4AVX2(v1, mul, crs, add, cross));
+	}
+	for (; i + 4 <= points; i += 4)
+		_mm256_storeu_ps(dst + 2*i, map4AVX2(_mm256_loadu_ps(src + 2*i), mul, crs, add, cross));
+	return i;
+}
+
+static bool hasAVX2() {
+	static const bool avx2 = __builtin_cpu_supports("avx2");
+	return avx2;
+}
+#endif
+
+static void mapInterleaved(float dst[], const float src[], int points, const MapCoeffs& k, bool cross) {
+	int done = 0;
+#if defined(__x86_64__) || defined(__i386__)
+	if (points >= 4 && hasAVX2())
+		done = mapInterleavedAVX2(dst, src, points, k, cross);
+	done += mapInterleavedSSE2(dst + 2*done, src + 2*done, points - done, k, cross);
+#endif
+	mapInterleavedScalar(dst + 2*done, src + 2*done, points - done, k, cross);
 }
 
 void GMatrix::mapPoints(GPoint dst[], const GPoint src[], int count) const {
+	static_assert(sizeof(GPoint) == 2 * sizeof(float), "GPoint must be two packed floats");
+	unsigned type = this->getType();
+	if (type == kIdentity_Mask) {
+		if (dst != src)
+			memmove(dst, src, count * sizeof(GPoint));
+		return;
+	}
+	MapCoeffs k = {{fMat[0], fMat[3]}, {fMat[2], fMat[1]}, {fMat[4], fMat[5]}};
+	mapInterleaved((float*)dst, (const float*)src, count, k, (type & kAffine_Mask) != 0);
+}
+
+void GMatrix::mapXY(float dstX[], float dstY[], const float srcX[], const float srcY[], int count) const {
+	unsigned type = this->getType();
+	if (type == kIdentity_Mask) {
+		if (dstX != srcX)
+			memmove(dstX, srcX, count * sizeof(float));
+		if (dstY != srcY)
+			memmove(dstY, srcY, count * sizeof(float));
+		return;
+	}
+	// separate planes need no shuffles, so plain loops vectorize as they are
+	float a = fMat[0], b = fMat[1], c = fMat[2], d = fMat[3], e = fMat[4], f = fMat[5];
+	if (!(type & kAffine_Mask)) {
+		for (int i=0; i<count; i++) {
+			dstX[i] = srcX[i] * a + e;
+			dstY[i] = srcY[i] * d + f;
+		}
+		return;
+	}
 	for (int i=0; i<count; i++) {
-		float sx = src[i].x;
-		dst[i].x = fMat[0] * sx + fMat[2] * src[i].y + fMat[4];
-		dst[i].y = fMat[1] * sx + fMat[3] * src[i].y + fMat[5];
+		float x = srcX[i];
+		float y = srcY[i];
+		dstX[i] = (x * a + y * c) + e;
+		dstY[i] = (y * d + x * b) + f;
 	}
-}
\ No newline at end of file
+}
@@ -1,16 +1,27 @@
 #ifndef alex_matrix_helpers_DEFINED
 #define alex_matrix_helpers_DEFINED
 
-static inline bool isScaleMatrix(GMatrix m) {
-	return m[0] == m[3] && 
-		   m[1] == 0 && 
-		   m[2] == 0;
+// Map a rect by a matrix that keeps it axis aligned (m.isScaleTranslate()).
+static inline GRect mapAxisAlignedRect(const GMatrix& m, const GRect& r) {
+	assert(m.isScaleTranslate());
+	GPoint pts[] = { {r.left, r.top}, {r.right, r.bottom} };
+	m.mapPoints(pts, 2);
+	return GRect::LTRB(std::min(pts[0].x, pts[1].x), std::min(pts[0].y, pts[1].y),
+					   std::max(pts[0].x, pts[1].x), std::max(pts[0].y, pts[1].y));
 }
 
-static inline bool isIdentity(GMatrix m) {
-	return m[0] == 1 && m[2] == 0 &&
-		   m[1] == 0 &&	m[3] == 1 &&
-		   m[4] == 0 && m[5] == 0;
+// bounds of the four mapped corners of r, for any matrix
+static inline GRect mapRectBounds(const GMatrix& m, const GRect& r) {
+	GPoint pts[] = { {r.left, r.top}, {r.right, r.top}, {r.right, r.bottom}, {r.left, r.bottom} };
+	m.mapPoints(pts, 4);
+	GRect b = GRect::LTRB(pts[0].x, pts[0].y, pts[0].x, pts[0].y);
+	for (int i=1; i<4; i++) {
+		b.left = std::min(b.left, pts[i].x);
+		b.top = std::min(b.top, pts[i].y);
+		b.right = std::max(b.right, pts[i].x);
+		b.bottom = std::max(b.bottom, pts[i].y);
+	}
+	return b;
 }
 
 static inline GMatrix computeBases(GPoint p0, GPoint p1, GPoint p2) {
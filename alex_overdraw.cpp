@@ -0,0 +1,259 @@
+/*
+ *  Device-space analysis of recorded display lists: op bounds and overdraw culling.
+ */
+#include "alex_recorder.h"
+#include "alex_region.h"
+#include "alex_types.h"
+#include "alex_utils.h"
+#include "alex_blend.h"
+#include "alex_matrix_helpers.h"
+
+using OpType = DisplayList::OpType;
+
+static GIRect intersect(const GIRect& a, const GIRect& b) {
+	GIRect r = GIRect::LTRB(std::max(a.left, b.left), std::max(a.top, b.top),
+							std::min(a.right, b.right), std::min(a.bottom, b.bottom));
+	return r.isEmpty() ? GIRect::LTRB(0, 0, 0, 0) : r;
+}
+
+static bool operator==(const GIRect& a, const GIRect& b) {
+	return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+}
+
+// pixels the local rect may touch once mapped by ctm
+static GIRect deviceBounds(const GRect& r, const GMatrix& ctm) {
+	GPoint pts[] = { {r.left, r.top}, {r.right, r.top}, {r.right, r.bottom}, {r.left, r.bottom} };
+	ctm.mapPoints(pts, 4);
+	GRect b = GRect::LTRB(pts[0].x, pts[0].y, pts[0].x, pts[0].y);
+	for (int i=1; i<4; i++) {
+		b.left = std::min(b.left, pts[i].x);
+		b.top = std::min(b.top, pts[i].y);
+		b.right = std::max(b.right, pts[i].x);
+		b.bottom = std::max(b.bottom, pts[i].y);
+	}
+	return b.roundOut();
+}
+
+static GRect pointBounds(const GPoint pts[], int count) {
+	GRect b = GRect::LTRB(pts[0].x, pts[0].y, pts[0].x, pts[0].y);
+	for (int i=1; i<count; i++) {
+		b.left = std::min(b.left, pts[i].x);
+		b.top = std::min(b.top, pts[i].y);
+		b.right = std::max(b.right, pts[i].x);
+		b.bottom = std::max(b.bottom, pts[i].y);
+	}
+	return b;
+}
+
+static GIRect outset(const GIRect& r, int d) {
+	return GIRect::LTRB(r.left - d, r.top - d, r.right + d, r.bottom + d);
+}
+
+// The blend mode MyCanvas will actually use for paint, or kDst if it draws nothing.
+static GBlendMode effectiveMode(const GPaint& paint, const GMatrix& ctm) {
+	GBlendMode mode = paint.getBlendMode();
+	if (mode == GBlendMode::kDst)
+		return mode;
+	GShader* shader = paint.peekShader();
+	if (!shader)
+		return optimizeBlendMode(mode, makePixelFromPaint(paint));
+	// a shader that can't be set up draws nothing; playback sets the context again
+	if (!shader->setContext(ctm))
+		return GBlendMode::kDst;
+	return shader->isOpaque() ? optimizeOpaqueBlendMode(mode) : mode;
+}
+
+// kSrc and kClear ignore the destination, so they hide whatever was drawn before
+static bool overwrites(GBlendMode mode) {
+	return mode == GBlendMode::kSrc || mode == GBlendMode::kClear;
+}
+
+void DisplayList::computeBounds(const GIRect& device, std::vector<OpBounds>* ops) const {
+	ops->reserve(fCount);
+	std::vector<OpBounds> stack;
+	OpBounds state = {nullptr, GMatrix(), device, true, GIRect::LTRB(0, 0, 0, 0), false};
+	for (Op* op = fHead; op; op = op->next) {
+		OpBounds info = state;
+		info.op = op;
+		switch (op->type) {
+			case OpType::kSave:
+				stack.push_back(state);
+				break;
+			case OpType::kRestore:
+				if (!stack.empty()) {
+					state = stack.back();
+					stack.pop_back();
+				}
+				break;
+			case OpType::kConcat:
+				state.ctm = state.ctm * static_cast<ConcatOp*>(op)->matrix;
+				break;
+			case OpType::kClipRect: {
+				const GRect& r = static_cast<ClipRectOp*>(op)->rect;
+				if (state.ctm.isScaleTranslate()) {
+					state.clip = intersect(state.clip, mapAxisAlignedRect(state.ctm, r).round());
+				} else {
+					state.clip = intersect(state.clip, deviceBounds(r, state.ctm));
+					state.clipIsRect = false;
+				}
+				break;
+			}
+			case OpType::kClipPath: {
+				GRect r = fPaths[static_cast<ClipPathOp*>(op)->path]->bounds();
+				state.clip = intersect(state.clip, outset(deviceBounds(r, state.ctm), 1));
+				state.clipIsRect = false;
+				break;
+			}
+			case OpType::kClear:
+				info.isDraw = true;
+				info.bounds = state.clip;
+				break;
+			case OpType::kDrawRect: {
+				const GRect& r = static_cast<DrawRectOp*>(op)->rect;
+				GIRect b = state.ctm.isScaleTranslate() ? mapAxisAlignedRect(state.ctm, r).round()
+														: deviceBounds(r, state.ctm);
+				info.isDraw = true;
+				info.bounds = intersect(b, state.clip);
+				break;
+			}
+			case OpType::kDrawConvexPolygon: {
+				auto p = static_cast<DrawConvexPolygonOp*>(op);
+				info.isDraw = true;
+				info.bounds = intersect(deviceBounds(pointBounds(p->points, p->count), state.ctm), state.clip);
+				break;
+			}
+			case OpType::kDrawPath: {
+				// flattened curves may round a pixel past the control point bounds
+				GRect r = fPaths[static_cast<DrawPathOp*>(op)->path]->bounds();
+				info.isDraw = true;
+				info.bounds = intersect(outset(deviceBounds(r, state.ctm), 1), state.clip);
+				break;
+			}
+			case OpType::kDrawMesh: {
+				// every triangle lies inside the bounds of the vertices
+				auto m = static_cast<DrawMeshOp*>(op);
+				int vertexCount = 0;
+				for (int i=0; i<3*m->count; i++)
+					vertexCount = std::max(vertexCount, m->indices[i] + 1);
+				info.isDraw = true;
+				info.bounds = intersect(deviceBounds(pointBounds(m->verts, vertexCount), state.ctm), state.clip);
+				break;
+			}
+			case OpType::kDrawQuad: {
+				auto q = static_cast<DrawQuadOp*>(op);
+				info.isDraw = true;
+				info.bounds = intersect(deviceBounds(pointBounds(q->verts, 4), state.ctm), state.clip);
+				break;
+			}
+		}
+		ops->push_back(info);
+	}
+}
+
+DisplayList::CullStats DisplayList::cullOverdraw() {
+	CullStats stats;
+	const GIRect device = GIRect::WH(fWidth, fHeight);
+
+	std::vector<OpBounds> ops;
+	this->computeBounds(device, &ops);
+	std::vector<bool> dropped(ops.size(), false);
+
+	// backward: drop draws inside the area later opaque draws overwrite
+	Arena scratch;
+	GRegion covered;
+	for (int i=(int)ops.size()-1; i>=0; i--) {
+		OpBounds& info = ops[i];
+		if (!info.isDraw)
+			continue;
+		if (info.bounds.isEmpty() || covered.contains(info.bounds)) {
+			dropped[i] = true;
+			stats.dropped += 1;
+			continue;
+		}
+
+		// meshes and quads build their own paints per triangle, so they never occlude
+		if (info.op->type == OpType::kDrawMesh || info.op->type == OpType::kDrawQuad)
+			continue;
+
+		GBlendMode mode = GBlendMode::kSrc;		// clear
+		bool solid = true;
+		if (info.op->type != OpType::kClear) {
+			const Paint* paint = nullptr;
+			switch (info.op->type) {
+				case OpType::kDrawRect:				paint = &static_cast<DrawRectOp*>(info.op)->paint; break;
+				case OpType::kDrawConvexPolygon:	paint = &static_cast<DrawConvexPolygonOp*>(info.op)->paint; break;
+				case OpType::kDrawPath:				paint = &static_cast<DrawPathOp*>(info.op)->paint; break;
+				default: break;
+			}
+			mode = effectiveMode(this->makePaint(*paint), info.ctm);
+			solid = paint->shader < 0;
+			if (mode == GBlendMode::kDst) {
+				dropped[i] = true;
+				stats.dropped += 1;
+				continue;
+			}
+		}
+
+		// only rects and clears under a rect clip cover exactly their bounds
+		bool isRect = info.op->type == OpType::kClear ||
+					  (info.op->type == OpType::kDrawRect && info.ctm.isScaleTranslate());
+		if (!isRect || !info.clipIsRect)
+			continue;
+
+		// trim solid rects to the part still visible (shaders keep their span starts)
+		if (info.op->type == OpType::kDrawRect && solid && !covered.isEmpty()) {
+			GRegion visible = GRegion::Difference(GRegion(info.bounds), covered, &scratch);
+			GIRect vb = visible.bounds();
+			if (!(vb == info.bounds)) {
+				auto r = static_cast<DrawRectOp*>(info.op);
+				GRect local = mapAxisAlignedRect(*info.ctm.invert(),
+												 GRect::LTRB(vb.left, vb.top, vb.right, vb.bottom));
+				if (mapAxisAlignedRect(info.ctm, local).round() == vb) {
+					r->rect = local;
+					stats.shrunk += 1;
+				}
+			}
+		}
+		if (overwrites(mode))
+			covered = GRegion::Union(covered, GRegion(info.bounds), &scratch);
+	}
+
+	// a first draw that fills the canvas with a solid color is just a clear (bounds are only
+	// exact for axis aligned rects under a rect clip, as above)
+	for (size_t i=0; i<ops.size(); i++) {
+		OpBounds& info = ops[i];
+		if (!info.isDraw || dropped[i])
+			continue;
+		if (info.op->type == OpType::kDrawRect && info.ctm.isScaleTranslate() && info.clipIsRect &&
+			info.bounds == device && info.clip == device) {
+			auto r = static_cast<DrawRectOp*>(info.op);
+			GPaint paint = this->makePaint(r->paint);
+			GBlendMode mode = paint.peekShader() ? GBlendMode::kDst : effectiveMode(paint, info.ctm);
+			if (overwrites(mode)) {
+				auto clear = new (fArena.alloc(sizeof(ClearOp), alignof(ClearOp))) ClearOp;
+				clear->type = OpType::kClear;
+				clear->color = mode == GBlendMode::kClear ? GColor::RGBA(0, 0, 0, 0) : paint.getColor();
+				info.op = clear;
+				stats.folded += 1;
+			}
+		}
+		break;
+	}
+
+	// relink the surviving ops
+	fHead = fTail = nullptr;
+	fCount = 0;
+	for (size_t i=0; i<ops.size(); i++) {
+		if (dropped[i])
+			continue;
+		Op* op = ops[i].op;
+		op->next = nullptr;
+		if (fTail)
+			fTail->next = op;
+		else
+			fHead = op;
+		fTail = op;
+		fCount += 1;
+	}
+	return stats;
+}
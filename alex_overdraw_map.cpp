@@ -0,0 +1,72 @@
+#include "alex_overdraw_map.h"
+#include "alex_json.h"
+#include <algorithm>
+
+OverdrawMap::Summary OverdrawMap::summarize(int buckets) const {
+	Summary s;
+	s.histogram.assign(std::max(buckets, 2), 0);
+	uint32_t last = (uint32_t)s.histogram.size() - 1;
+	for (int y=0; y<fHeight; y++) {
+		const uint32_t* counts = this->row(y);
+		for (int x=0; x<fWidth; x++) {
+			uint32_t n = counts[x];
+			s.histogram[std::min(n, last)]++;
+			s.writes += n;
+			s.max = std::max(s.max, n);
+		}
+	}
+	s.pixels = (uint64_t)fWidth * fHeight;
+	s.written = s.pixels - s.histogram[0];
+	s.mean = s.pixels ? (double)s.writes / s.pixels : 0;
+	s.meanWritten = s.written ? (double)s.writes / s.written : 0;
+	return s;
+}
+
+std::string OverdrawMap::Summary::toJSON() const {
+	std::string out;
+	JSONWriter w(&out);
+	w.beginObject();
+	w.value("pixels", pixels);
+	w.value("written", written);
+	w.value("writes", writes);
+	w.value("max", (uint64_t)max);
+	w.value("mean", mean);
+	w.value("meanWritten", meanWritten);
+	w.beginArray("histogram");
+	for (uint64_t n : histogram)
+		w.value(nullptr, n);
+	w.endArray();
+	w.endObject();
+	return out;
+}
+
+static const GPixel gHeatColors[] = {
+	GPixel_PackARGB(255,   0,   0,   0),
+	GPixel_PackARGB(255,   0,   0, 192),
+	GPixel_PackARGB(255,   0, 192, 255),
+	GPixel_PackARGB(255,   0, 192,   0),
+	GPixel_PackARGB(255, 255, 255,   0),
+	GPixel_PackARGB(255, 255, 128,   0),
+	GPixel_PackARGB(255, 255,   0,   0),
+	GPixel_PackARGB(255, 255,   0, 255),
+	GPixel_PackARGB(255, 255, 255, 255),
+};
+constexpr uint32_t kHeatColorCount = sizeof(gHeatColors) / sizeof(gHeatColors[0]);
+
+void OverdrawMap::drawHeatmap(GBitmap* dst) const {
+	dst->alloc(fWidth, fHeight);
+	for (int y=0; y<fHeight; y++) {
+		const uint32_t* counts = this->row(y);
+		GPixel* pixels = dst->getAddr(0, y);
+		for (int x=0; x<fWidth; x++)
+			pixels[x] = gHeatColors[std::min(counts[x], kHeatColorCount - 1)];
+	}
+}
+
+bool OverdrawMap::writeHeatmap(const char path[]) const {
+	GBitmap heatmap;
+	this->drawHeatmap(&heatmap);
+	bool ok = heatmap.writeToFile(path);
+	heatmap.release();
+	return ok;
+}
@@ -0,0 +1,63 @@
+#ifndef alex_overdraw_map_DEFINED
+#define alex_overdraw_map_DEFINED
+
+#include "include/GBitmap.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ *  How many times each pixel of a device was written, filled in after
+ *  MyCanvas::setOverdraw(). Every pixel a blit or clear touches counts once, whatever its
+ *  alpha or blend mode, so the counts show where layers pile up.
+ */
+class OverdrawMap {
+public:
+	OverdrawMap(int width, int height)
+		: fWidth(width), fHeight(height), fCounts((size_t)width * height) {}
+
+	int width() const { return fWidth; }
+	int height() const { return fHeight; }
+
+	const uint32_t* row(int y) const { return fCounts.data() + (size_t)y * fWidth; }
+	uint32_t count(int x, int y) const { return this->row(y)[x]; }
+
+	// Count pixels [left, right) of row y once more.
+	void addRow(int y, int left, int right) {
+		uint32_t* counts = fCounts.data() + (size_t)y * fWidth;
+		for (int x=left; x<right; x++)
+			counts[x]++;
+	}
+
+	void reset() { std::fill(fCounts.begin(), fCounts.end(), 0); }
+
+	struct Summary {
+		uint64_t pixels = 0;		// in the device
+		uint64_t written = 0;		// written at least once
+		uint64_t writes = 0;
+		uint32_t max = 0;
+		double mean = 0;			// writes per device pixel
+		double meanWritten = 0;		// writes per pixel written
+		// histogram[n] is the number of pixels written n times; the last bucket also holds
+		// every pixel written more often
+		std::vector<uint64_t> histogram;
+
+		std::string toJSON() const;
+	};
+	Summary summarize(int buckets = 16) const;
+
+	/*
+	 *  Alloc dst to the map's size and fill it with a false-color view: black where nothing
+	 *  was drawn, then blue, cyan, green, yellow, orange, red and magenta for 1 to 7 writes,
+	 *  and white for more. The scale is fixed so heatmaps of different scenes compare.
+	 */
+	void drawHeatmap(GBitmap* dst) const;
+	bool writeHeatmap(const char path[]) const;
+
+private:
+	int fWidth;
+	int fHeight;
+	std::vector<uint32_t> fCounts;
+};
+
+#endif
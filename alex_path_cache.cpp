@@ -0,0 +1,139 @@
+#include "alex_path_cache.h"
+#include <cstring>
+
+static inline uint64_t hashBytes(uint64_t h, const void* data, size_t n) {
+	// FNV-1a
+	const uint8_t* bytes = (const uint8_t*)data;
+	for (size_t i=0; i<n; i++) {
+		h ^= bytes[i];
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+
+// Copy the verbs and new points of path into key, hashing them into key->pathHash.
+static void setPath(const GPath& path, PathCacheKey* key) {
+	key->verbs.clear();
+	key->pts.clear();
+	GPoint pts[GPath::kMaxNextPoints];
+	GPath::Iter iter(path);
+	while (auto v = iter.next(pts)) {
+		GPathVerb verb = v.value();
+		key->verbs.push_back(verb);
+		// pts[0] of a segment is the previous end point, so only keep the new ones
+		switch (verb) {
+			case GPathVerb::kMove:
+				key->pts.push_back(pts[0]);
+				break;
+			case GPathVerb::kLine:
+				key->pts.push_back(pts[1]);
+				break;
+			case GPathVerb::kQuad:
+				key->pts.insert(key->pts.end(), pts + 1, pts + 3);
+				break;
+			case GPathVerb::kCubic:
+				key->pts.insert(key->pts.end(), pts + 1, pts + 4);
+				break;
+		}
+	}
+	uint64_t h = 14695981039346656037ull;
+	h = hashBytes(h, key->verbs.data(), key->verbs.size() * sizeof(GPathVerb));
+	key->pathHash = hashBytes(h, key->pts.data(), key->pts.size() * sizeof(GPoint));
+}
+
+bool PathCacheKey::operator==(const PathCacheKey& k) const {
+	return pathHash == k.pathHash &&
+		   mat[0] == k.mat[0] && mat[1] == k.mat[1] &&
+		   mat[2] == k.mat[2] && mat[3] == k.mat[3] &&
+		   subX == k.subX && subY == k.subY &&
+		   verbs == k.verbs && pts.size() == k.pts.size() &&
+		   !memcmp(pts.data(), k.pts.data(), pts.size() * sizeof(GPoint));
+}
+
+size_t PathCacheKeyHash::operator()(const PathCacheKey* k) const {
+	// +0 folds -0 into 0, which compare equal
+	float mat[4] = { k->mat[0] + 0.0f, k->mat[1] + 0.0f, k->mat[2] + 0.0f, k->mat[3] + 0.0f };
+	uint64_t h = hashBytes(k->pathHash, mat, sizeof(mat));
+	int sub[2] = { k->subX, k->subY };
+	return (size_t)hashBytes(h, sub, sizeof(sub));
+}
+
+const PathCacheKey& PathCache::makeKey(const GPath& path, const GMatrix& ctm, GMatrix* rasterMatrix,
+									   int* ix, int* iy) {
+	PathCacheKey& key = fLookup;
+	setPath(path, &key);
+	key.mat[0] = ctm[0];
+	key.mat[1] = ctm[1];
+	key.mat[2] = ctm[2];
+	key.mat[3] = ctm[3];
+
+	// split translation into integer part + snapped fraction
+	float tx = ctm[4];
+	float ty = ctm[5];
+	*ix = GFloorToInt(tx);
+	*iy = GFloorToInt(ty);
+	key.subX = std::min(GFloorToInt((tx - *ix) * kPathCacheSubpixel), kPathCacheSubpixel - 1);
+	key.subY = std::min(GFloorToInt((ty - *iy) * kPathCacheSubpixel), kPathCacheSubpixel - 1);
+
+	*rasterMatrix = GMatrix(ctm[0], ctm[2], (float)key.subX / kPathCacheSubpixel,
+							ctm[1], ctm[3], (float)key.subY / kPathCacheSubpixel);
+	return key;
+}
+
+void PathCache::setBudget(size_t bytes) {
+	fBudget = bytes;
+	this->evictTo(bytes);
+}
+
+void PathCache::resetStats() {
+	fStats.hits = 0;
+	fStats.misses = 0;
+	fStats.evictions = 0;
+}
+
+void PathCache::purge() {
+	fEntries.clear();
+	fMap.clear();
+	fStats.bytesUsed = 0;
+	fStats.entries = 0;
+}
+
+const PathCacheEntry* PathCache::find(const PathCacheKey& key) {
+	auto it = fMap.find(&key);
+	if (it == fMap.end()) {
+		fStats.misses += 1;
+		return nullptr;
+	}
+	fStats.hits += 1;
+	// move to front
+	fEntries.splice(fEntries.begin(), fEntries, it->second);
+	return &fEntries.front();
+}
+
+const PathCacheEntry* PathCache::add(PathCacheEntry&& entry) {
+	entry.spans.shrink_to_fit();
+	size_t bytes = entry.bytes();
+	if (bytes > fBudget)
+		return nullptr;
+	auto it = fMap.find(&entry.key);
+	if (it != fMap.end())
+		return &*it->second;
+
+	this->evictTo(fBudget - bytes);
+	fEntries.push_front(std::move(entry));
+	fMap[&fEntries.front().key] = fEntries.begin();
+	fStats.bytesUsed += bytes;
+	fStats.entries += 1;
+	return &fEntries.front();
+}
+
+void PathCache::evictTo(size_t bytes) {
+	while (fStats.bytesUsed > bytes && !fEntries.empty()) {
+		const PathCacheEntry& last = fEntries.back();
+		fStats.bytesUsed -= last.bytes();
+		fStats.entries -= 1;
+		fStats.evictions += 1;
+		fMap.erase(&last.key);
+		fEntries.pop_back();
+	}
+}
@@ -0,0 +1,99 @@
+#ifndef alex_path_cache_DEFINED
+#define alex_path_cache_DEFINED
+
+#include "include/GMatrix.h"
+#include "include/GPath.h"
+#include "alex_types.h"
+#include <list>
+#include <unordered_map>
+
+// fractional translations are snapped to 1/kPathCacheSubpixel of a pixel
+constexpr int kPathCacheSubpixel = 4;
+
+struct PathCacheKey {
+	uint64_t pathHash;		// points + verbs
+	float mat[4];			// non-translate part of the CTM
+	int subX, subY;			// subpixel translation bucket
+	// the path itself, compared when everything else matches so a hash collision is a miss
+	std::vector<GPathVerb> verbs;
+	std::vector<GPoint> pts;	// the points each verb adds
+
+	bool operator==(const PathCacheKey& k) const;
+};
+
+// Hash and compare keys through pointers, so the map shares the keys stored in the entries.
+struct PathCacheKeyHash {
+	size_t operator()(const PathCacheKey* k) const;
+};
+struct PathCacheKeyEqual {
+	bool operator()(const PathCacheKey* a, const PathCacheKey* b) const { return *a == *b; }
+};
+
+/*
+ *  Spans of a rasterized path, relative to (originX, originY). To draw it, offset the
+ *  spans by the integer part of the CTM translation plus the origin.
+ */
+struct PathCacheEntry {
+	PathCacheKey key;
+	std::vector<Span> spans;
+	int originX;
+	int originY;
+
+	size_t bytes() const {
+		return sizeof(PathCacheEntry) + spans.capacity() * sizeof(Span) +
+			   key.verbs.capacity() * sizeof(GPathVerb) + key.pts.capacity() * sizeof(GPoint);
+	}
+};
+
+struct PathCacheStats {
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	uint64_t evictions = 0;
+	size_t bytesUsed = 0;
+	int entries = 0;
+};
+
+/*
+ *  LRU cache of rasterized paths, keyed by path geometry plus the CTM minus its integer
+ *  translation. A budget of 0 (the default) disables the cache.
+ */
+class PathCache {
+public:
+	PathCache(size_t budget = 0) : fBudget(budget) {}
+
+	size_t budget() const { return fBudget; }
+	void setBudget(size_t bytes);
+	const PathCacheStats& stats() const { return fStats; }
+	void resetStats();
+	void purge();
+
+	/*
+	 *  Compute the key for drawing path with ctm. rasterMatrix is set to the matrix the
+	 *  path should be rasterized with on a miss, and (ix, iy) to the integer translation
+	 *  to add when blitting the cached spans. The key is overwritten by the next call, which
+	 *  reuses its storage.
+	 */
+	const PathCacheKey& makeKey(const GPath&, const GMatrix& ctm, GMatrix* rasterMatrix,
+								int* ix, int* iy);
+
+	// Return the entry for key (marking it most recently used), or nullptr on a miss.
+	const PathCacheEntry* find(const PathCacheKey&);
+
+	// Take ownership of entry, evicting older entries to stay within budget. Returns the
+	// cached entry, or nullptr (and evicts nothing) if the entry alone is over budget.
+	const PathCacheEntry* add(PathCacheEntry&& entry);
+
+private:
+	using EntryList = std::list<PathCacheEntry>;
+
+	size_t fBudget;
+	EntryList fEntries;		// front = most recently used
+	// keyed by the key in each entry
+	std::unordered_map<const PathCacheKey*, EntryList::iterator, PathCacheKeyHash, PathCacheKeyEqual> fMap;
+	PathCacheStats fStats;
+	PathCacheKey fLookup;	// returned by makeKey
+
+	void evictTo(size_t bytes);
+};
+
+#endif
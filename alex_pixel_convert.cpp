@@ -0,0 +1,238 @@
+#include "alex_pixel_convert.h"
+#include <algorithm>
+
+/*
+ *  Unpremultiplying divides by alpha. Instead each color computes
+ *  	(float)(c * 255 + a/2 + 0.25) * (1.0f / a)
+ *  and truncates. The sum is exact, and the product is within 2^-23 of the true quotient, which
+ *  is at most 255.5 when c <= a. The extra 0.25 / a is larger than that error and smaller than
+ *  the 1/a gap to the next integer, so the truncation lands where the integer division does.
+ *  recip[0] is 1/255 rather than infinity, which turns the formula into a copy for a = 0.
+ *  A color above its alpha is not valid premultiplied data, and would unpremultiply past 255;
+ *  every path saturates it to 255, so it can't spill into the next channel.
+ */
+static const struct UnpremulTable {
+	float recip[256];
+
+	UnpremulTable() {
+		recip[0] = 1.0f / 255;
+		for (int a=1; a<256; a++)
+			recip[a] = 1.0f / a;
+	}
+} gUnpremul;
+
+static inline int unpremul(int c, int a) {
+	return std::min((int)(((float)(c * 255) + ((float)(a >> 1) + 0.25f)) * gUnpremul.recip[a]), 255);
+}
+
+static void unpremulScalar(uint8_t dst[], const GPixel src[], int count) {
+	for (int i=0; i<count; i++) {
+		GPixel c = src[i];
+		int a = GPixel_GetA(c);
+		int r = GPixel_GetR(c);
+		int g = GPixel_GetG(c);
+		int b = GPixel_GetB(c);
+		if (0 != a && 255 != a) {
+			r = unpremul(r, a);
+			g = unpremul(g, a);
+			b = unpremul(b, a);
+		}
+		*dst++ = r;
+		*dst++ = g;
+		*dst++ = b;
+		*dst++ = a;
+	}
+}
+
+// (c * a + 127) / 255, which is c * a / 255 rounded (it never ends in exactly .5)
+static inline unsigned premul(unsigned c, unsigned a) {
+	return (c * a + 127) / 255;
+}
+
+static void premulScalar(GPixel dst[], const uint8_t src[], int count) {
+	for (int i=0; i<count; i++) {
+		unsigned a = src[3];
+		if (a == 255)
+			dst[i] = GPixel_PackARGB(255, src[0], src[1], src[2]);
+		else if (a == 0)
+			dst[i] = 0;
+		else
+			dst[i] = GPixel_PackARGB(a, premul(src[0], a), premul(src[1], a), premul(src[2], a));
+		src += 4;
+	}
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+static_assert(GPIXEL_SHIFT_A == 24 && GPIXEL_SHIFT_R == 16 && GPIXEL_SHIFT_G == 8 &&
+			  GPIXEL_SHIFT_B == 0, "vector converters assume BGRA byte order");
+
+// The vector loops below do 4 (SSE2) or 8 (AVX2) pixels at a time, skip the arithmetic when
+// every pixel is opaque or transparent, and return how many pixels they converted.
+
+static inline __m128i unpremul4(__m128i c, __m128 bias, __m128 recip) {
+	__m128 n = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(c), _mm_set1_ps(255)), bias);
+	__m128i u = _mm_cvttps_epi32(_mm_mul_ps(n, recip));
+	// min(u, 255); SSE2 has no 32-bit min
+	__m128i over = _mm_cmpgt_epi32(u, _mm_set1_epi32(255));
+	return _mm_or_si128(_mm_andnot_si128(over, u), _mm_and_si128(over, _mm_set1_epi32(255)));
+}
+
+static int unpremulSSE2(uint8_t dst[], const GPixel src[], int count) {
+	const __m128i byte = _mm_set1_epi32(0xFF);
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+		__m128i a = _mm_srli_epi32(v, 24);
+		__m128i r = _mm_and_si128(_mm_srli_epi32(v, 16), byte);
+		__m128i g = _mm_and_si128(_mm_srli_epi32(v, 8), byte);
+		__m128i b = _mm_and_si128(v, byte);
+		__m128i extreme = _mm_or_si128(_mm_cmpeq_epi32(a, _mm_setzero_si128()), _mm_cmpeq_epi32(a, byte));
+		if (_mm_movemask_epi8(extreme) != 0xFFFF) {
+			alignas(16) int alphas[4];
+			_mm_store_si128((__m128i*)alphas, a);
+			__m128 recip = _mm_setr_ps(gUnpremul.recip[alphas[0]], gUnpremul.recip[alphas[1]],
+									   gUnpremul.recip[alphas[2]], gUnpremul.recip[alphas[3]]);
+			__m128 bias = _mm_add_ps(_mm_cvtepi32_ps(_mm_srli_epi32(a, 1)), _mm_set1_ps(0.25f));
+			r = unpremul4(r, bias, recip);
+			g = unpremul4(g, bias, recip);
+			b = unpremul4(b, bias, recip);
+		}
+		__m128i rgba = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)),
+									_mm_or_si128(_mm_slli_epi32(b, 16), _mm_slli_epi32(a, 24)));
+		_mm_storeu_si128((__m128i*)(dst + 4*i), rgba);
+	}
+	return i;
+}
+
+// 2 pixels as RGBA 16-bit lanes, premultiplied and reordered to BGRA
+static inline __m128i premul2(__m128i px) {
+	__m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(px, _MM_SHUFFLE(3, 3, 3, 3)),
+										_MM_SHUFFLE(3, 3, 3, 3));
+	// alpha is scaled by 255 so it comes through unchanged
+	alpha = _mm_or_si128(_mm_and_si128(alpha, _mm_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0)),
+						 _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255));
+	__m128i t = _mm_add_epi16(_mm_mullo_epi16(px, alpha), _mm_set1_epi16(128));
+	t = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+	return _mm_shufflehi_epi16(_mm_shufflelo_epi16(t, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+}
+
+static int premulSSE2(GPixel dst[], const uint8_t src[], int count) {
+	const __m128i alphaBytes = _mm_set1_epi32(0xFF000000);
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i*)(src + 4*i));
+		__m128i a = _mm_and_si128(v, alphaBytes);
+		__m128i out;
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, alphaBytes)) == 0xFFFF) {
+			// opaque: swap R and B
+			out = _mm_or_si128(_mm_and_si128(v, _mm_set1_epi32(0xFF00FF00)),
+							   _mm_or_si128(_mm_and_si128(_mm_srli_epi32(v, 16), _mm_set1_epi32(0xFF)),
+											_mm_slli_epi32(_mm_and_si128(v, _mm_set1_epi32(0xFF)), 16)));
+		} else if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, _mm_setzero_si128())) == 0xFFFF) {
+			out = _mm_setzero_si128();
+		} else {
+			__m128i zero = _mm_setzero_si128();
+			out = _mm_packus_epi16(premul2(_mm_unpacklo_epi8(v, zero)), premul2(_mm_unpackhi_epi8(v, zero)));
+		}
+		_mm_storeu_si128((__m128i*)(dst + i), out);
+	}
+	return i;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i unpremul8(__m256i c, __m256 bias, __m256 recip) {
+	__m256 n = _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(c), _mm256_set1_ps(255)), bias);
+	return _mm256_min_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(n, recip)), _mm256_set1_epi32(255));
+}
+
+__attribute__((target("avx2")))
+static int unpremulAVX2(uint8_t dst[], const GPixel src[], int count) {
+	const __m256i byte = _mm256_set1_epi32(0xFF);
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+		__m256i a = _mm256_srli_epi32(v, 24);
+		__m256i r = _mm256_and_si256(_mm256_srli_epi32(v, 16), byte);
+		__m256i g = _mm256_and_si256(_mm256_srli_epi32(v, 8), byte);
+		__m256i b = _mm256_and_si256(v, byte);
+		__m256i extreme = _mm256_or_si256(_mm256_cmpeq_epi32(a, _mm256_setzero_si256()),
+										  _mm256_cmpeq_epi32(a, byte));
+		if (_mm256_movemask_epi8(extreme) != -1) {
+			__m256 recip = _mm256_i32gather_ps(gUnpremul.recip, a, 4);
+			__m256 bias = _mm256_add_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(a, 1)), _mm256_set1_ps(0.25f));
+			r = unpremul8(r, bias, recip);
+			g = unpremul8(g, bias, recip);
+			b = unpremul8(b, bias, recip);
+		}
+		__m256i rgba = _mm256_or_si256(_mm256_or_si256(r, _mm256_slli_epi32(g, 8)),
+									   _mm256_or_si256(_mm256_slli_epi32(b, 16), _mm256_slli_epi32(a, 24)));
+		_mm256_storeu_si256((__m256i*)(dst + 4*i), rgba);
+	}
+	return i;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i premul4AVX2(__m256i px) {
+	const __m256i swapRB = _mm256_setr_epi8(4, 5, 2, 3, 0, 1, 6, 7, 12, 13, 10, 11, 8, 9, 14, 15,
+											4, 5, 2, 3, 0, 1, 6, 7, 12, 13, 10, 11, 8, 9, 14, 15);
+	const __m256i spreadA = _mm256_setr_epi8(6, 7, 6, 7, 6, 7, -1, -1, 14, 15, 14, 15, 14, 15, -1, -1,
+											 6, 7, 6, 7, 6, 7, -1, -1, 14, 15, 14, 15, 14, 15, -1, -1);
+	__m256i alpha = _mm256_or_si256(_mm256_shuffle_epi8(px, spreadA),
+									_mm256_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255));
+	__m256i t = _mm256_add_epi16(_mm256_mullo_epi16(px, alpha), _mm256_set1_epi16(128));
+	t = _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+	return _mm256_shuffle_epi8(t, swapRB);
+}
+
+__attribute__((target("avx2")))
+static int premulAVX2(GPixel dst[], const uint8_t src[], int count) {
+	const __m256i alphaBytes = _mm256_set1_epi32(0xFF000000);
+	const __m256i swapRB = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+											2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)(src + 4*i));
+		__m256i a = _mm256_and_si256(v, alphaBytes);
+		__m256i out;
+		if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(a, alphaBytes)) == -1) {
+			out = _mm256_shuffle_epi8(v, swapRB);
+		} else if (_mm256_testz_si256(a, a)) {
+			out = _mm256_setzero_si256();
+		} else {
+			__m256i zero = _mm256_setzero_si256();
+			// unpack and pack both work within 128-bit halves, so the pixel order survives
+			out = _mm256_packus_epi16(premul4AVX2(_mm256_unpacklo_epi8(v, zero)),
+									  premul4AVX2(_mm256_unpackhi_epi8(v, zero)));
+		}
+		_mm256_storeu_si256((__m256i*)(dst + i), out);
+	}
+	return i;
+}
+
+static bool hasAVX2() {
+	static const bool avx2 = __builtin_cpu_supports("avx2");
+	return avx2;
+}
+#endif
+
+void UnpremulToRGBA(uint8_t dst[], const GPixel src[], int count) {
+	int done = 0;
+#if defined(__x86_64__) || defined(__i386__)
+	if (count >= 8 && hasAVX2())
+		done = unpremulAVX2(dst, src, count);
+	done += unpremulSSE2(dst + 4*done, src + done, count - done);
+#endif
+	unpremulScalar(dst + 4*done, src + done, count - done);
+}
+
+void PremulFromRGBA(GPixel dst[], const uint8_t src[], int count) {
+	int done = 0;
+#if defined(__x86_64__) || defined(__i386__)
+	if (count >= 8 && hasAVX2())
+		done = premulAVX2(dst, src, count);
+	done += premulSSE2(dst + done, src + 4*done, count - done);
+#endif
+	premulScalar(dst + done, src + 4*done, count - done);
+}
@@ -0,0 +1,19 @@
+#ifndef alex_pixel_convert_DEFINED
+#define alex_pixel_convert_DEFINED
+
+#include "include/GPixel.h"
+
+/*
+ *  Row converters between GPixel and the unpremultiplied RGBA bytes image files store. Both
+ *  round exactly as the per-channel formulas noted below, so files are byte-for-byte the same
+ *  whichever path (SSE2, AVX2 or scalar) converts them.
+ */
+
+// Premultiplied src to unpremultiplied RGBA, each color (c * 255 + a/2) / a. Colors of
+// transparent pixels are copied as they are; colors above alpha (invalid) come out as 255.
+void UnpremulToRGBA(uint8_t dst[], const GPixel src[], int count);
+
+// Unpremultiplied RGBA src to premultiplied dst, each color (c * a + 127) / 255.
+void PremulFromRGBA(GPixel dst[], const uint8_t src[], int count);
+
+#endif
@@ -0,0 +1,274 @@
+#include "alex_png_encoder.h"
+#include "alex_pixel_convert.h"
+#include "alex_render_context.h"
+#include "src/lodepng.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <vector>
+
+static uint8_t paeth(int a, int b, int c) {
+	int p = a + b - c;
+	int pa = abs(p - a);
+	int pb = abs(p - b);
+	int pc = abs(p - c);
+	if (pa <= pb && pa <= pc)
+		return (uint8_t)a;
+	return (uint8_t)(pb <= pc ? b : c);
+}
+
+// PNG filter type 0..4 of row (prev is null for the first row); bytes per pixel is 4
+static void filterRow(uint8_t dst[], const uint8_t row[], const uint8_t prev[], size_t n, int type) {
+	switch (type) {
+		case 0:
+			memcpy(dst, row, n);
+			break;
+		case 1:
+			for (size_t i=0; i<n; i++)
+				dst[i] = (uint8_t)(row[i] - (i >= 4 ? row[i - 4] : 0));
+			break;
+		case 2:
+			for (size_t i=0; i<n; i++)
+				dst[i] = (uint8_t)(row[i] - (prev ? prev[i] : 0));
+			break;
+		case 3:
+			for (size_t i=0; i<n; i++) {
+				int a = i >= 4 ? row[i - 4] : 0;
+				int b = prev ? prev[i] : 0;
+				dst[i] = (uint8_t)(row[i] - ((a + b) >> 1));
+			}
+			break;
+		case 4:
+			for (size_t i=0; i<n; i++) {
+				int a = i >= 4 ? row[i - 4] : 0;
+				int b = prev ? prev[i] : 0;
+				int c = (prev && i >= 4) ? prev[i - 4] : 0;
+				dst[i] = (uint8_t)(row[i] - paeth(a, b, c));
+			}
+			break;
+	}
+}
+
+// Filter row into dst[0] = type, dst[1..n] = bytes, picking the type with the smallest sum of
+// absolute (signed) differences, as lodepng's default strategy does.
+static void filterRowMinSum(uint8_t dst[], const uint8_t row[], const uint8_t prev[], size_t n,
+							uint8_t scratch[]) {
+	size_t best = 0;
+	for (int type=0; type<5; type++) {
+		uint8_t* out = type == 0 ? dst + 1 : scratch;
+		filterRow(out, row, prev, n, type);
+		size_t sum = 0;
+		for (size_t i=0; i<n; i++)
+			sum += type == 0 ? out[i] : (out[i] < 128 ? out[i] : 255 - out[i]);
+		if (type == 0 || sum < best) {
+			best = sum;
+			dst[0] = (uint8_t)type;
+			if (type != 0)
+				memcpy(dst + 1, scratch, n);
+		}
+	}
+}
+
+// adler32 of A followed by B, from adler32(A), adler32(B) and B's length (as zlib's
+// adler32_combine)
+static unsigned combineAdler32(unsigned adlerA, unsigned adlerB, size_t lengthB) {
+	const unsigned kBase = 65521;
+	unsigned rem = (unsigned)(lengthB % kBase);
+	unsigned sum1 = adlerA & 0xffff;
+	unsigned sum2 = (rem * sum1) % kBase;
+	sum1 += (adlerB & 0xffff) + kBase - 1;
+	sum2 += ((adlerA >> 16) & 0xffff) + ((adlerB >> 16) & 0xffff) + kBase - rem;
+	if (sum1 >= kBase) sum1 -= kBase;
+	if (sum1 >= kBase) sum1 -= kBase;
+	if (sum2 >= 2 * kBase) sum2 -= 2 * kBase;
+	if (sum2 >= kBase) sum2 -= kBase;
+	return sum1 | (sum2 << 16);
+}
+
+static void compressSettings(int level, LodePNGCompressSettings* settings) {
+	lodepng_compress_settings_init(settings);
+	if (level <= 0) {
+		settings->btype = 0;
+		return;
+	}
+	level = std::min(level, 9);
+	settings->windowsize = 1u << std::min(15, 7 + level);	// 256 .. 32768
+	settings->lazymatching = level >= 4;
+	settings->nicematch = level >= 9 ? 258 : 128;
+}
+
+static bool writeAll(int fd, const uint8_t data[], size_t size) {
+	while (size > 0) {
+		ssize_t n = write(fd, data, size);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		data += n;
+		size -= n;
+	}
+	return true;
+}
+
+static void putBE32(uint8_t dst[], unsigned v) {
+	dst[0] = (uint8_t)(v >> 24);
+	dst[1] = (uint8_t)(v >> 16);
+	dst[2] = (uint8_t)(v >> 8);
+	dst[3] = (uint8_t)v;
+}
+
+// chunk[0..8) is room for the length and type, chunk[8..8+length) the data, and chunk must have
+// 4 more bytes for the CRC
+static bool writeChunk(int fd, uint8_t chunk[], const char type[4], size_t length) {
+	putBE32(chunk, (unsigned)length);
+	memcpy(chunk + 4, type, 4);
+	putBE32(chunk + 8 + length, lodepng_crc32(chunk + 4, length + 4));
+	return writeAll(fd, chunk, length + 12);
+}
+
+namespace {
+// One strip of rows, compressed independently of the others.
+struct Strip {
+	const GBitmap* rows;
+	int top;					// in rows
+	int bottom;
+	const GPixel* above;		// the image row before top, or null for the image's first row
+	bool first;					// starts the zlib stream
+	bool last;					// ends it
+	size_t filteredSize = 0;	// bytes the strip adds to the zlib stream's data
+	unsigned adler = 1;			// of just this strip's filtered bytes
+	// IDAT chunk: 8 bytes for the header, the deflated data (after the zlib header in the first
+	// strip), then room for the adler32 trailer and the CRC
+	uint8_t* chunk = nullptr;
+	size_t size = 0;			// bytes of chunk used, header included
+
+	void encode(const LodePNGCompressSettings& settings) {
+		const int w = rows->width();
+		const size_t rb = w * 4;
+		const size_t filteredRB = rb + 1;	// each row starts with its filter type
+		filteredSize = (bottom - top) * filteredRB;
+
+		// two unpremultiplied rows (this one and the one above), a filter attempt and the strip
+		std::vector<uint8_t> buffer(3 * rb + filteredSize);
+		uint8_t* curr = buffer.data();
+		uint8_t* prev = curr + rb;
+		uint8_t* scratch = prev + rb;
+		uint8_t* filtered = scratch + rb;
+		// the row above the strip is only read, to filter against
+		if (above)
+			UnpremulToRGBA(prev, above, w);
+		uint8_t* dst = filtered;
+		for (int y=top; y<bottom; y++) {
+			UnpremulToRGBA(curr, rows->getAddr(0, y), w);
+			filterRowMinSum(dst, curr, (y > top || above) ? prev : nullptr, rb, scratch);
+			std::swap(curr, prev);
+			dst += filteredRB;
+		}
+		adler = lodepng_update_adler32(1, filtered, filteredSize);
+
+		size = first ? 10 : 8;
+		chunk = (uint8_t*)malloc(size);
+		if (!chunk)
+			return;
+		if (first) {
+			chunk[8] = 0x78;	// deflate, 32K window
+			chunk[9] = 0x01;	// no dictionary, check bits
+		}
+		if (lodepng_deflate_part(&chunk, &size, filtered, filteredSize, &settings, last)) {
+			free(chunk);
+			chunk = nullptr;
+			return;
+		}
+		uint8_t* grown = (uint8_t*)realloc(chunk, size + 8);
+		if (!grown)
+			free(chunk);
+		chunk = grown;
+	}
+};
+}
+
+PngWriter::PngWriter(int fd, int width, int height, const PngEncodeOptions& options)
+	: fFD(fd), fWidth(width), fHeight(height), fOptions(options) {}
+
+bool PngWriter::writeHeader() {
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	if (!writeAll(fFD, signature, 8))
+		return false;
+	uint8_t ihdr[8 + 13 + 4];
+	putBE32(ihdr + 8, fWidth);
+	putBE32(ihdr + 12, fHeight);
+	ihdr[16] = 8;	// bits per channel
+	ihdr[17] = 6;	// RGBA
+	ihdr[18] = 0;	// deflate
+	ihdr[19] = 0;	// adaptive filtering
+	ihdr[20] = 0;	// not interlaced
+	return writeChunk(fFD, ihdr, "IHDR", 13);
+}
+
+bool PngWriter::writeRows(const GBitmap& rows) {
+	const int w = fWidth;
+	const int h = fHeight;
+	fOK = fOK && w > 0 && h > 0 && rows.width() == w && rows.height() <= h - fRowsWritten;
+	if (!fOK || rows.height() == 0)
+		return fOK;
+	if (fRowsWritten == 0)
+		fOK = this->writeHeader();
+
+	LodePNGCompressSettings settings;
+	compressSettings(fOptions.level, &settings);
+	ThreadPool& pool = (fOptions.context ? fOptions.context : RenderContext::Default())->pool();
+
+	constexpr size_t kStripBytes = 256 << 10;
+	const int stripRows = (int)std::max<size_t>(1, kStripBytes / (w * 4 + 1));
+	// strips in flight: enough to keep every thread busy while earlier ones are written
+	const int batchSize = 2 * pool.concurrency();
+	std::vector<Strip> batch;
+	for (int y=0; y<rows.height() && fOK; ) {
+		batch.clear();
+		for (; y<rows.height() && (int)batch.size()<batchSize; y+=stripRows) {
+			Strip strip;
+			strip.rows = &rows;
+			strip.top = y;
+			strip.bottom = std::min(rows.height(), y + stripRows);
+			strip.above = y > 0 ? rows.getAddr(0, y - 1) : fRowsWritten > 0 ? fLastRow.data() : nullptr;
+			strip.first = fRowsWritten + y == 0;
+			strip.last = fRowsWritten + strip.bottom == h;
+			batch.push_back(strip);
+		}
+		pool.parallelFor((int)batch.size(), [&](int i) {
+			batch[i].encode(settings);
+		});
+		// write in order, freeing every chunk even after a failure
+		for (Strip& strip : batch) {
+			fOK = fOK && strip.chunk;
+			if (fOK) {
+				fAdler = combineAdler32(fAdler, strip.adler, strip.filteredSize);
+				if (strip.last) {
+					putBE32(strip.chunk + strip.size, fAdler);
+					strip.size += 4;
+				}
+				fOK = writeChunk(fFD, strip.chunk, "IDAT", strip.size - 8);
+			}
+			free(strip.chunk);
+		}
+	}
+	if (!fOK)
+		return false;
+
+	fRowsWritten += rows.height();
+	if (this->finished()) {
+		uint8_t iend[12];
+		fOK = writeChunk(fFD, iend, "IEND", 0);
+	} else {
+		const GPixel* last = rows.getAddr(0, rows.height() - 1);
+		fLastRow.assign(last, last + w);
+	}
+	return fOK;
+}
+
+bool EncodePNG(const GBitmap& bitmap, int fd, const PngEncodeOptions& options) {
+	PngWriter writer(fd, bitmap.width(), bitmap.height(), options);
+	return writer.writeRows(bitmap) && writer.finished();
+}
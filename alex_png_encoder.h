@@ -0,0 +1,58 @@
+#ifndef alex_png_encoder_DEFINED
+#define alex_png_encoder_DEFINED
+
+#include "include/GBitmap.h"
+#include <vector>
+
+class RenderContext;
+
+struct PngEncodeOptions {
+	// 0 stores the data uncompressed; 1..9 trade speed for size as zlib's levels do
+	int level = kDefaultLevel;
+	// strips are compressed on this context's pool (RenderContext::Default() if null); give it
+	// one thread to encode on the calling thread only
+	RenderContext* context = nullptr;
+
+	// the settings lodepng uses on its own
+	static constexpr int kDefaultLevel = 4;
+};
+
+/*
+ *  Writes a PNG a band of rows at a time, so the whole image never has to be in memory. Each
+ *  band is unpremultiplied, filtered and deflated in strips of about 256KB, several strips at once
+ *  on the pool, and written in order as IDAT chunks. As in pigz, every strip but the last ends
+ *  with a sync flush, so the strips form a single zlib stream.
+ */
+class PngWriter {
+public:
+	PngWriter(int fd, int width, int height, const PngEncodeOptions& options = PngEncodeOptions());
+
+	PngWriter(const PngWriter&) = delete;
+	PngWriter& operator=(const PngWriter&) = delete;
+
+	// Append the next rows.height() rows; rows.width() must be the image width. The header goes
+	// out with the first rows and the end of the file with the last. rows may be reused once
+	// this returns. Returns false (now and from then on) on a write or allocation failure, or
+	// when there are more rows than the image has.
+	bool writeRows(const GBitmap& rows);
+
+	// true once all the rows have been written
+	bool finished() const { return fRowsWritten == fHeight; }
+
+private:
+	int fFD;
+	int fWidth;
+	int fHeight;
+	PngEncodeOptions fOptions;
+	int fRowsWritten = 0;
+	unsigned fAdler = 1;
+	bool fOK = true;
+	std::vector<GPixel> fLastRow;	// the row above the next band, to filter against
+
+	bool writeHeader();
+};
+
+// Write bitmap to fd as an RGBA PNG with a single PngWriter band.
+bool EncodePNG(const GBitmap& bitmap, int fd, const PngEncodeOptions& options = PngEncodeOptions());
+
+#endif
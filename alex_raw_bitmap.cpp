@@ -0,0 +1,121 @@
+#include "alex_raw_bitmap.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+struct RawHeader {
+	char magic[8];
+	uint32_t byteOrder;		// kByteOrder as written by the host
+	uint32_t flags;
+	int32_t width;
+	int32_t height;
+	uint64_t rowBytes;
+	uint64_t pixelOffset;	// from the start of the file
+	uint64_t pixelBytes;	// (height - 1) * rowBytes + width * 4
+	uint8_t reserved[16];
+
+	static constexpr char kMagic[8] = { 'G', 'B', 'I', 'T', 'M', 'A', 'P', '1' };
+	static constexpr uint32_t kByteOrder = 0x01020304;
+	static constexpr uint32_t kOpaqueFlag = 1;
+};
+static_assert(sizeof(RawHeader) == 64, "pixels follow a 64-byte header");
+}
+
+// bytes of pixels a bitmap spans; the last row stops at its last pixel
+static size_t pixelBytes(const GBitmap& bitmap) {
+	return (bitmap.height() - 1) * bitmap.rowBytes() + bitmap.width() * 4;
+}
+
+static bool writeAll(int fd, iovec iov[], int count) {
+	while (count > 0) {
+		ssize_t n = writev(fd, iov, count);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		// a short write leaves the rest of the current buffer and those after it
+		for (; count > 0 && (size_t)n >= iov->iov_len; iov++, count--)
+			n -= iov->iov_len;
+		if (count > 0) {
+			iov->iov_base = (char*)iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+	return true;
+}
+
+bool WriteRawBitmap(const GBitmap& bitmap, int fd) {
+	if (bitmap.width() <= 0 || bitmap.height() <= 0)
+		return false;
+	RawHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, RawHeader::kMagic, sizeof(header.magic));
+	header.byteOrder = RawHeader::kByteOrder;
+	header.flags = bitmap.isOpaque() ? RawHeader::kOpaqueFlag : 0;
+	header.width = bitmap.width();
+	header.height = bitmap.height();
+	header.rowBytes = bitmap.rowBytes();
+	header.pixelOffset = sizeof(header);
+	header.pixelBytes = pixelBytes(bitmap);
+
+	iovec iov[2] = {
+		{ &header, sizeof(header) },
+		{ bitmap.pixels(), header.pixelBytes },
+	};
+	return writeAll(fd, iov, 2);
+}
+
+bool WriteRawBitmap(const GBitmap& bitmap, const char path[]) {
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return false;
+	bool ok = WriteRawBitmap(bitmap, fd);
+	return close(fd) == 0 && ok;
+}
+
+static bool validHeader(const RawHeader& h, size_t fileSize) {
+	if (memcmp(h.magic, RawHeader::kMagic, sizeof(h.magic)) != 0 || h.byteOrder != RawHeader::kByteOrder)
+		return false;
+	if (h.width <= 0 || h.height <= 0 || h.rowBytes % 4 != 0 || h.rowBytes / 4 < (uint64_t)h.width)
+		return false;
+	if (h.pixelOffset < sizeof(RawHeader) || h.pixelOffset % 64 != 0)
+		return false;
+	uint64_t expected = (uint64_t)(h.height - 1) * h.rowBytes + (uint64_t)h.width * 4;
+	return h.pixelBytes == expected && h.pixelOffset <= fileSize &&
+		   h.pixelBytes <= fileSize - h.pixelOffset;
+}
+
+std::unique_ptr<MappedBitmap> MappedBitmap::Open(const char path[]) {
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return nullptr;
+	struct stat st;
+	void* base = MAP_FAILED;
+	size_t size = 0;
+	if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(RawHeader)) {
+		size = st.st_size;
+		base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	}
+	close(fd);	// the mapping keeps the file
+	if (base == MAP_FAILED)
+		return nullptr;
+
+	const RawHeader& header = *(const RawHeader*)base;
+	if (!validHeader(header, size)) {
+		munmap(base, size);
+		return nullptr;
+	}
+	GBitmap bitmap(header.width, header.height, header.rowBytes,
+				   (GPixel*)((char*)base + header.pixelOffset),
+				   (header.flags & RawHeader::kOpaqueFlag) != 0);
+	return std::unique_ptr<MappedBitmap>(new MappedBitmap(base, size, bitmap));
+}
+
+MappedBitmap::~MappedBitmap() {
+	munmap(fBase, fSize);
+}
@@ -0,0 +1,46 @@
+#ifndef alex_raw_bitmap_DEFINED
+#define alex_raw_bitmap_DEFINED
+
+#include "include/GBitmap.h"
+#include <memory>
+
+/*
+ *  Uncompressed bitmap files, for passing images between stages without a PNG round trip.
+ *  A file is a 64-byte header followed by the pixels exactly as they are in memory:
+ *  premultiplied GPixels (BGRA bytes), rows rowBytes apart. The pixels start at a multiple of 64
+ *  bytes into the file, so once it is mapped, rows are as aligned as alloc() makes them.
+ *  The byte order is the host's; files from a host of the other order are rejected.
+ */
+
+// Write bitmap to a new file (created or overwritten) with one writev of the header and the
+// pixels. Return true on success.
+bool WriteRawBitmap(const GBitmap& bitmap, const char path[]);
+bool WriteRawBitmap(const GBitmap& bitmap, int fd);
+
+/*
+ *  A raw bitmap file mapped into memory. bitmap() points straight at the mapping; nothing is
+ *  read until it is touched. The mapping is private, so drawing into the bitmap copies just the
+ *  pages written and never changes the file.
+ */
+class MappedBitmap {
+public:
+	// Return null if path can't be opened or mapped, or isn't a valid raw bitmap.
+	static std::unique_ptr<MappedBitmap> Open(const char path[]);
+
+	~MappedBitmap();
+
+	MappedBitmap(const MappedBitmap&) = delete;
+	MappedBitmap& operator=(const MappedBitmap&) = delete;
+
+	const GBitmap& bitmap() const { return fBitmap; }
+
+private:
+	MappedBitmap(void* base, size_t size, const GBitmap& bitmap)
+		: fBase(base), fSize(size), fBitmap(bitmap) {}
+
+	void* fBase;
+	size_t fSize;
+	GBitmap fBitmap;
+};
+
+#endif
@@ -0,0 +1,222 @@
+#include "alex_recorder.h"
+#include <new>
+
+GPaint DisplayList::makePaint(const Paint& p, const std::shared_ptr<GShader>* shaders) const {
+	GPaint paint(p.color);
+	paint.setBlendMode(p.mode);
+	if (p.shader >= 0)
+		paint.setShader(shaders ? shaders[p.shader] : fShaders[p.shader]);
+	return paint;
+}
+
+DisplayList::Paint DisplayList::recordPaint(const GPaint& paint) {
+	Paint p = {paint.getColor(), paint.getBlendMode(), -1};
+	GShader* shader = paint.peekShader();
+	if (shader) {
+		auto it = fShaderIndex.find(shader);
+		if (it == fShaderIndex.end()) {
+			it = fShaderIndex.emplace(shader, (int)fShaders.size()).first;
+			fShaders.push_back(paint.shareShader());
+		}
+		p.shader = it->second;
+	}
+	return p;
+}
+
+int DisplayList::recordPath(const GPath& path) {
+	auto it = fPathIndex.find(&path);
+	if (it != fPathIndex.end())
+		return it->second;
+
+	// paths are immutable, so share the caller's if it is ref-counted, else copy it
+	std::shared_ptr<GPath> shared = std::const_pointer_cast<GPath>(path.weak_from_this().lock());
+	if (!shared) {
+		std::vector<GPoint> pts;
+		std::vector<GPathVerb> vbs;
+		pts.reserve(path.countPoints());
+		GPoint p[GPath::kMaxNextPoints];
+		GPath::Iter iter(path);
+		while (auto v = iter.next(p)) {
+			vbs.push_back(v.value());
+			// p[0] of a segment repeats the previous point
+			switch (v.value()) {
+				case GPathVerb::kMove:	pts.push_back(p[0]); break;
+				case GPathVerb::kLine:	pts.insert(pts.end(), p + 1, p + 2); break;
+				case GPathVerb::kQuad:	pts.insert(pts.end(), p + 1, p + 3); break;
+				case GPathVerb::kCubic:	pts.insert(pts.end(), p + 1, p + 4); break;
+			}
+		}
+		shared = std::make_shared<GPath>(std::move(pts), std::move(vbs));
+	} else {
+		// only remember addresses of paths we keep alive
+		fPathIndex.emplace(&path, (int)fPaths.size());
+	}
+	fPaths.push_back(std::move(shared));
+	return (int)fPaths.size() - 1;
+}
+
+void DisplayList::playOp(GCanvas* canvas, const Op* op, const std::shared_ptr<GShader>* shaders) const {
+	switch (op->type) {
+		case OpType::kSave:
+			canvas->save();
+			break;
+		case OpType::kRestore:
+			canvas->restore();
+			break;
+		case OpType::kConcat:
+			canvas->concat(static_cast<const ConcatOp*>(op)->matrix);
+			break;
+		case OpType::kClipRect:
+			canvas->clipRect(static_cast<const ClipRectOp*>(op)->rect);
+			break;
+		case OpType::kClipPath:
+			canvas->clipPath(*fPaths[static_cast<const ClipPathOp*>(op)->path]);
+			break;
+		case OpType::kClear:
+			canvas->clear(static_cast<const ClearOp*>(op)->color);
+			break;
+		case OpType::kDrawRect: {
+			auto r = static_cast<const DrawRectOp*>(op);
+			canvas->drawRect(r->rect, this->makePaint(r->paint, shaders));
+			break;
+		}
+		case OpType::kDrawConvexPolygon: {
+			auto p = static_cast<const DrawConvexPolygonOp*>(op);
+			canvas->drawConvexPolygon(p->points, p->count, this->makePaint(p->paint, shaders));
+			break;
+		}
+		case OpType::kDrawPath: {
+			auto p = static_cast<const DrawPathOp*>(op);
+			canvas->drawPath(*fPaths[p->path], this->makePaint(p->paint, shaders));
+			break;
+		}
+		case OpType::kDrawMesh: {
+			auto m = static_cast<const DrawMeshOp*>(op);
+			canvas->drawMesh(m->verts, m->colors, m->texs, m->count, m->indices, this->makePaint(m->paint, shaders));
+			break;
+		}
+		case OpType::kDrawQuad: {
+			auto q = static_cast<const DrawQuadOp*>(op);
+			canvas->drawQuad(q->verts, q->hasColors ? q->colors : nullptr, q->hasTexs ? q->texs : nullptr,
+							 q->level, this->makePaint(q->paint, shaders));
+			break;
+		}
+	}
+}
+
+void DisplayList::playback(GCanvas* canvas) const {
+	int depth = 0;
+	for (const Op* op = fHead; op; op = op->next) {
+		if (op->type == OpType::kSave)
+			depth += 1;
+		else if (op->type == OpType::kRestore)
+			depth -= 1;
+		this->playOp(canvas, op);
+	}
+	// unbalanced saves in the recording
+	for (; depth > 0; depth--)
+		canvas->restore();
+}
+
+void DisplayList::playback(GCanvas* canvas, const GMatrix& matrix) const {
+	canvas->save();
+	canvas->concat(matrix);
+	this->playback(canvas);
+	canvas->restore();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+RecordingCanvas::RecordingCanvas(int width, int height)
+	: fList(std::make_unique<DisplayList>(width, height)) {}
+
+std::unique_ptr<DisplayList> RecordingCanvas::finishRecording() {
+	std::unique_ptr<DisplayList> list = std::move(fList);
+	fList = std::make_unique<DisplayList>(list->width(), list->height());
+	fSaveCount = 0;
+	return list;
+}
+
+void RecordingCanvas::save() {
+	fList->append<DisplayList::Op>(DisplayList::OpType::kSave);
+	fSaveCount += 1;
+}
+
+void RecordingCanvas::restore() {
+	if (fSaveCount == 0)
+		return;
+	fList->append<DisplayList::Op>(DisplayList::OpType::kRestore);
+	fSaveCount -= 1;
+}
+
+void RecordingCanvas::concat(const GMatrix& matrix) {
+	if (matrix.isIdentity())
+		return;
+	fList->append<DisplayList::ConcatOp>(DisplayList::OpType::kConcat)->matrix = matrix;
+}
+
+void RecordingCanvas::clipRect(const GRect& rect) {
+	fList->append<DisplayList::ClipRectOp>(DisplayList::OpType::kClipRect)->rect = rect;
+}
+
+void RecordingCanvas::clipPath(const GPath& path) {
+	int index = fList->recordPath(path);
+	fList->append<DisplayList::ClipPathOp>(DisplayList::OpType::kClipPath)->path = index;
+}
+
+void RecordingCanvas::clear(const GColor& color) {
+	fList->append<DisplayList::ClearOp>(DisplayList::OpType::kClear)->color = color;
+}
+
+void RecordingCanvas::drawRect(const GRect& rect, const GPaint& paint) {
+	auto op = fList->append<DisplayList::DrawRectOp>(DisplayList::OpType::kDrawRect);
+	op->rect = rect;
+	op->paint = fList->recordPaint(paint);
+}
+
+void RecordingCanvas::drawConvexPolygon(const GPoint points[], int count, const GPaint& paint) {
+	if (count < 3)
+		return;
+	auto op = fList->append<DisplayList::DrawConvexPolygonOp>(DisplayList::OpType::kDrawConvexPolygon);
+	op->points = fList->copyArray(points, count);
+	op->count = count;
+	op->paint = fList->recordPaint(paint);
+}
+
+void RecordingCanvas::drawPath(const GPath& path, const GPaint& paint) {
+	auto op = fList->append<DisplayList::DrawPathOp>(DisplayList::OpType::kDrawPath);
+	op->path = fList->recordPath(path);
+	op->paint = fList->recordPaint(paint);
+}
+
+void RecordingCanvas::drawMesh(const GPoint verts[], const GColor colors[], const GPoint texs[],
+							   int count, const int indices[], const GPaint& paint) {
+	if (count <= 0)
+		return;
+	// copy only the vertices the triangles use
+	int vertexCount = 0;
+	for (int i=0; i<3*count; i++)
+		vertexCount = std::max(vertexCount, indices[i] + 1);
+
+	auto op = fList->append<DisplayList::DrawMeshOp>(DisplayList::OpType::kDrawMesh);
+	op->verts = fList->copyArray(verts, vertexCount);
+	op->colors = colors ? fList->copyArray(colors, vertexCount) : nullptr;
+	op->texs = texs ? fList->copyArray(texs, vertexCount) : nullptr;
+	op->indices = fList->copyArray(indices, 3 * count);
+	op->count = count;
+	op->paint = fList->recordPaint(paint);
+}
+
+void RecordingCanvas::drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4],
+							   int level, const GPaint& paint) {
+	auto op = fList->append<DisplayList::DrawQuadOp>(DisplayList::OpType::kDrawQuad);
+	memcpy(op->verts, verts, sizeof(op->verts));
+	op->hasColors = colors != nullptr;
+	if (colors)
+		memcpy(op->colors, colors, sizeof(op->colors));
+	op->hasTexs = texs != nullptr;
+	if (texs)
+		memcpy(op->texs, texs, sizeof(op->texs));
+	op->level = level;
+	op->paint = fList->recordPaint(paint);
+}
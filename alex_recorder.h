@@ -0,0 +1,222 @@
+#ifndef alex_recorder_DEFINED
+#define alex_recorder_DEFINED
+
+#include "include/GBitmap.h"
+#include "include/GCanvas.h"
+#include "include/GColor.h"
+#include "include/GMatrix.h"
+#include "include/GPaint.h"
+#include "include/GPath.h"
+#include "include/GRect.h"
+#include "include/GShader.h"
+#include "alex_arena.h"
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class CanvasDevice;
+class RenderContext;
+
+/*
+ *  A recorded scene: a chain of ops allocated from an arena. Shaders and paths are held by
+ *  reference (shared_ptr) in side tables and ops refer to them by index, so recording a
+ *  paint or path never copies more than a pointer once it has been seen.
+ */
+class DisplayList {
+public:
+	enum class OpType : uint8_t {
+		kSave,
+		kRestore,
+		kConcat,
+		kClipRect,
+		kClipPath,
+		kClear,
+		kDrawRect,
+		kDrawConvexPolygon,
+		kDrawPath,
+		kDrawMesh,
+		kDrawQuad,
+	};
+
+	// GPaint with its shader replaced by an index into the shader table (-1 for none)
+	struct Paint {
+		GColor color;
+		GBlendMode mode;
+		int shader;
+	};
+
+	struct Op {
+		OpType type;
+		Op* next;
+	};
+	struct ConcatOp : Op {
+		GMatrix matrix;
+	};
+	struct ClipRectOp : Op {
+		GRect rect;
+	};
+	struct ClipPathOp : Op {
+		int path;
+	};
+	struct ClearOp : Op {
+		GColor color;
+	};
+	struct DrawRectOp : Op {
+		GRect rect;
+		Paint paint;
+	};
+	struct DrawConvexPolygonOp : Op {
+		const GPoint* points;
+		int count;
+		Paint paint;
+	};
+	struct DrawPathOp : Op {
+		int path;
+		Paint paint;
+	};
+	struct DrawMeshOp : Op {
+		const GPoint* verts;
+		const GColor* colors;	// may be null
+		const GPoint* texs;		// may be null
+		const int* indices;
+		int count;
+		Paint paint;
+	};
+	struct DrawQuadOp : Op {
+		GPoint verts[4];
+		GColor colors[4];
+		GPoint texs[4];
+		bool hasColors;
+		bool hasTexs;
+		int level;
+		Paint paint;
+	};
+
+	DisplayList(int width, int height) : fWidth(width), fHeight(height) {}
+
+	DisplayList(const DisplayList&) = delete;
+	DisplayList& operator=(const DisplayList&) = delete;
+
+	// size of the canvas the scene was recorded for
+	int width() const { return fWidth; }
+	int height() const { return fHeight; }
+
+	int count() const { return fCount; }
+	const Op* first() const { return fHead; }
+
+	// Replay the ops into canvas, leaving its save/restore depth as it was.
+	void playback(GCanvas* canvas) const;
+	// Replay with matrix applied first, e.g. GMatrix::Scale(newWidth / width(), ...) to render
+	// the scene at another size.
+	void playback(GCanvas* canvas, const GMatrix& matrix) const;
+
+	static constexpr int kPlaybackTileSize = 64;
+	// Replay into device as kPlaybackTileSize square tiles drawn concurrently on the context's
+	// pool (RenderContext::Default() if null), each by its own MyCanvas that only runs the
+	// draws touching it. The pixels match playback() into GCreateCanvas(device). Each tile
+	// shades with its own GShader::makeCopy() of the recorded shaders; draws with shaders
+	// that can't be copied run one at a time.
+	void playbackTiled(const GBitmap& device, RenderContext* context = nullptr) const;
+	// As above, but only draw the pixels inside area (which must lie within device); no other
+	// pixel of device is read or written.
+	void playbackTiled(const GBitmap& device, const GIRect& area, RenderContext* context = nullptr) const;
+	// As above into a device whose pixels may be only partly in memory, which must hold all of
+	// area. Draws part of a scene into a bitmap the size of that part.
+	void playbackTiled(const CanvasDevice& device, const GIRect& area, RenderContext* context = nullptr) const;
+
+	struct CullStats {
+		int dropped = 0;	// draws removed because later opaque draws hide them
+		int shrunk = 0;		// solid rects trimmed to their visible bounds
+		int folded = 0;		// leading full-canvas rects turned into clears
+	};
+	// Remove or trim draws that later opaque draws completely overwrite. Coverage is
+	// computed for width() x height(), so the result is only exact for playback at the
+	// recorded size without a matrix.
+	CullStats cullOverdraw();
+
+	// shaders, if not null, replaces the recorded shader table (same indices)
+	GPaint makePaint(const Paint&, const std::shared_ptr<GShader>* shaders = nullptr) const;
+	const GPath& path(int index) const { return *fPaths[index]; }
+
+private:
+	friend class RecordingCanvas;
+
+	int fWidth;
+	int fHeight;
+	Arena fArena;
+	Op* fHead = nullptr;
+	Op* fTail = nullptr;
+	int fCount = 0;
+	std::vector<std::shared_ptr<GShader>> fShaders;
+	std::unordered_map<const GShader*, int> fShaderIndex;
+	std::vector<std::shared_ptr<GPath>> fPaths;
+	std::unordered_map<const GPath*, int> fPathIndex;
+
+	template <typename T> T* append(OpType type) {
+		T* op = new (fArena.alloc(sizeof(T), alignof(T))) T;
+		op->type = type;
+		op->next = nullptr;
+		if (fTail)
+			fTail->next = op;
+		else
+			fHead = op;
+		fTail = op;
+		fCount += 1;
+		return op;
+	}
+	template <typename T> const T* copyArray(const T src[], int count) {
+		T* dst = fArena.makeArray<T>(count);
+		memcpy(dst, src, count * sizeof(T));
+		return dst;
+	}
+	void playOp(GCanvas*, const Op*, const std::shared_ptr<GShader>* shaders = nullptr) const;
+	// index of the recorded shader op draws with, or -1
+	int shaderIndex(const Op*) const;
+
+	Paint recordPaint(const GPaint&);
+	int recordPath(const GPath&);
+
+	// the state an op runs with and the pixels it may touch, when played into device
+	struct OpBounds {
+		Op* op;
+		GMatrix ctm;
+		GIRect clip;		// device bounds of the clip
+		bool clipIsRect;	// false once a path or rotated rect has been clipped to
+		GIRect bounds;		// conservative, and empty for ops that don't draw
+		bool isDraw;
+	};
+	void computeBounds(const GIRect& device, std::vector<OpBounds>*) const;
+};
+
+/*
+ *  GCanvas that records into a DisplayList instead of drawing.
+ */
+class RecordingCanvas : public GCanvas {
+public:
+	RecordingCanvas(int width, int height);
+
+	void save() override;
+	void restore() override;
+	void concat(const GMatrix&) override;
+	void clipRect(const GRect&) override;
+	void clipPath(const GPath&) override;
+	void clear(const GColor&) override;
+	void drawRect(const GRect&, const GPaint&) override;
+	void drawConvexPolygon(const GPoint[], int count, const GPaint&) override;
+	void drawPath(const GPath&, const GPaint&) override;
+	void drawMesh(const GPoint verts[], const GColor colors[], const GPoint texs[],
+				  int count, const int indices[], const GPaint&) override;
+	void drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4],
+				  int level, const GPaint&) override;
+
+	// Return what has been recorded so far; the canvas starts a new, empty list.
+	std::unique_ptr<DisplayList> finishRecording();
+
+private:
+	std::unique_ptr<DisplayList> fList;
+	// Saves not yet restored. A restore without one is dropped, so no list ever restores past
+	// the state of the canvas it is played into.
+	int fSaveCount = 0;
+};
+
+#endif
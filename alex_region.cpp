@@ -0,0 +1,265 @@
+#include "alex_region.h"
+#include <climits>
+
+GRegion::GRegion(const GIRect& r) : fBounds(GIRect::LTRB(0, 0, 0, 0)) {
+	if (r.isEmpty())
+		return;
+	fCount = 1;
+	fBounds = r;
+	fRect = {r.top, r.bottom, r.left, r.right};
+}
+
+/*
+ *  Appends bands top to bottom. Intervals that touch are merged, and a band whose intervals
+ *  match the band directly above it is folded into that band.
+ */
+class RegionBuilder {
+public:
+	RegionBuilder(Arena* arena) : fArena(arena) {}
+
+	void beginBand(int top, int bottom) {
+		fTop = top;
+		fBottom = bottom;
+		fBandStart = fCount;
+	}
+
+	void addInterval(int left, int right) {
+		if (fCount > fBandStart && fRuns[fCount-1].right == left) {
+			fRuns[fCount-1].right = right;
+			return;
+		}
+		if (fCount == fCapacity)
+			this->grow();
+		fRuns[fCount++] = {fTop, fBottom, left, right};
+	}
+
+	void endBand() {
+		int n = fCount - fBandStart;
+		if (n == 0)
+			return;
+		// fold into the previous band if it is adjacent and identical
+		if (fPrevStart >= 0 && fCount - n - fPrevStart == n && fRuns[fPrevStart].bottom == fTop) {
+			bool same = true;
+			for (int i=0; same && i<n; i++) {
+				same = fRuns[fPrevStart + i].left == fRuns[fBandStart + i].left &&
+					   fRuns[fPrevStart + i].right == fRuns[fBandStart + i].right;
+			}
+			if (same) {
+				for (int i=0; i<n; i++)
+					fRuns[fPrevStart + i].bottom = fBottom;
+				fCount = fBandStart;
+				return;
+			}
+		}
+		fPrevStart = fBandStart;
+	}
+
+	GRegion detach() {
+		GRegion region;
+		if (fCount == 0)
+			return region;
+		int left = fRuns[0].left;
+		int right = fRuns[0].right;
+		for (int i=1; i<fCount; i++) {
+			left = std::min(left, fRuns[i].left);
+			right = std::max(right, fRuns[i].right);
+		}
+		region.fBounds = GIRect::LTRB(left, fRuns[0].top, right, fRuns[fCount-1].bottom);
+		region.fCount = fCount;
+		if (fCount == 1)
+			region.fRect = fRuns[0];
+		else
+			region.fRuns = fRuns;
+		return region;
+	}
+
+private:
+	Arena* fArena;
+	RegionRun* fRuns = nullptr;
+	int fCount = 0;
+	int fCapacity = 0;
+	int fTop = 0;
+	int fBottom = 0;
+	int fBandStart = 0;
+	int fPrevStart = -1;
+
+	void grow() {
+		int capacity = std::max(16, fCapacity * 2);
+		RegionRun* runs = fArena->makeArray<RegionRun>(capacity);
+		if (fCount > 0)
+			memcpy(runs, fRuns, fCount * sizeof(RegionRun));
+		fRuns = runs;
+		fCapacity = capacity;
+	}
+};
+
+GRegion GRegion::FromSpans(const Span spans[], int count, Arena* arena) {
+	RegionBuilder builder(arena);
+	int i = 0;
+	while (i < count) {
+		int y = spans[i].y;
+		builder.beginBand(y, y + 1);
+		for (; i < count && spans[i].y == y; i++)
+			builder.addInterval(spans[i].left, spans[i].right);
+		builder.endBand();
+	}
+	return builder.detach();
+}
+
+// one past the last run of the band starting at runs[i]
+static inline int bandEnd(const RegionRun runs[], int count, int i) {
+	int top = runs[i].top;
+	while (i < count && runs[i].top == top)
+		i++;
+	return i;
+}
+
+static inline bool applyOp(GRegion::Op op, bool inA, bool inB) {
+	switch (op) {
+		case GRegion::kUnion:		return inA || inB;
+		case GRegion::kIntersect:	return inA && inB;
+		case GRegion::kDifference:	return inA && !inB;
+	}
+	return false;
+}
+
+// Merge two sorted interval lists, emitting the intervals where op holds.
+static void combineIntervals(const RegionRun a[], int na, const RegionRun b[], int nb,
+							 GRegion::Op op, RegionBuilder* out) {
+	// walk the 2*n interval end points of each list in x order
+	int i = 0;
+	int j = 0;
+	bool inA = false;
+	bool inB = false;
+	bool on = false;
+	int start = 0;
+	while (i < 2 * na || j < 2 * nb) {
+		int xa = i < 2 * na ? ((i & 1) ? a[i >> 1].right : a[i >> 1].left) : INT_MAX;
+		int xb = j < 2 * nb ? ((j & 1) ? b[j >> 1].right : b[j >> 1].left) : INT_MAX;
+		int x = std::min(xa, xb);
+		if (xa == x) {
+			inA = !inA;
+			i++;
+		}
+		if (xb == x) {
+			inB = !inB;
+			j++;
+		}
+		bool now = applyOp(op, inA, inB);
+		if (now && !on)
+			start = x;
+		else if (!now && on)
+			out->addInterval(start, x);
+		on = now;
+	}
+}
+
+GRegion GRegion::Combine(const GRegion& a, const GRegion& b, Op op, Arena* arena) {
+	// trivial cases need no storage
+	switch (op) {
+		case kUnion:
+			if (b.isEmpty() || (a.isRect() && a.contains(b.fBounds)))
+				return a;
+			if (a.isEmpty() || (b.isRect() && b.contains(a.fBounds)))
+				return b;
+			break;
+		case kIntersect:
+			if (!irectsIntersect(a.fBounds, b.fBounds))
+				return GRegion();
+			if (a.isRect() && b.isRect()) {
+				const GIRect& r = a.fBounds;
+				const GIRect& s = b.fBounds;
+				return GRegion(GIRect::LTRB(std::max(r.left, s.left), std::max(r.top, s.top),
+											std::min(r.right, s.right), std::min(r.bottom, s.bottom)));
+			}
+			if (a.isRect() && a.contains(b.fBounds))
+				return b;
+			if (b.isRect() && b.contains(a.fBounds))
+				return a;
+			break;
+		case kDifference:
+			if (a.isEmpty() || !irectsIntersect(a.fBounds, b.fBounds))
+				return a;
+			if (b.isRect() && b.contains(a.fBounds))
+				return GRegion();
+			break;
+	}
+
+	RegionBuilder out(arena);
+	const RegionRun* ra = a.begin();
+	const RegionRun* rb = b.begin();
+	int na = a.fCount;
+	int nb = b.fCount;
+	int ia = 0;
+	int ib = 0;
+	int y = INT_MIN;
+	while (ia < na || ib < nb) {
+		if (op == kIntersect && (ia == na || ib == nb))
+			break;
+		if (op == kDifference && ia == na)
+			break;
+		int aTop = ia < na ? ra[ia].top : INT_MAX;
+		int bTop = ib < nb ? rb[ib].top : INT_MAX;
+		int aBottom = ia < na ? ra[ia].bottom : INT_MAX;
+		int bBottom = ib < nb ? rb[ib].bottom : INT_MAX;
+		// skip rows where neither has a band
+		y = std::max(y, std::min(aTop, bTop));
+		bool aIn = aTop <= y;
+		bool bIn = bTop <= y;
+		int aEnd = aIn ? bandEnd(ra, na, ia) : ia;
+		int bEnd = bIn ? bandEnd(rb, nb, ib) : ib;
+		// the slice ends where either band starts or stops
+		int yEnd = std::min(aIn ? aBottom : aTop, bIn ? bBottom : bTop);
+
+		out.beginBand(y, yEnd);
+		combineIntervals(ra + ia, aEnd - ia, rb + ib, bEnd - ib, op, &out);
+		out.endBand();
+
+		y = yEnd;
+		if (aIn && aBottom == y)
+			ia = aEnd;
+		if (bIn && bBottom == y)
+			ib = bEnd;
+	}
+	return out.detach();
+}
+
+const RegionRun* GRegion::findBand(int y) const {
+	// bands don't overlap, so bottoms increase with the run index
+	const RegionRun* lo = this->begin();
+	const RegionRun* hi = this->end();
+	while (lo < hi) {
+		const RegionRun* mid = lo + (hi - lo) / 2;
+		if (mid->bottom <= y)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	// runs of a band share a bottom, so this is the first run of its band
+	return lo;
+}
+
+bool GRegion::contains(const GIRect& r) const {
+	if (r.isEmpty())
+		return true;
+	if (r.left < fBounds.left || r.top < fBounds.top || r.right > fBounds.right || r.bottom > fBounds.bottom)
+		return false;
+	if (this->isRect())
+		return true;
+	const RegionRun* run = this->findBand(r.top);
+	const RegionRun* stop = this->end();
+	int y = r.top;
+	while (y < r.bottom) {
+		// each band down to r.bottom must start where the last ended and cover [left, right)
+		if (run == stop || run->top > y)
+			return false;
+		int top = run->top;
+		bool covered = false;
+		for (; run < stop && run->top == top; run++)
+			covered |= run->left <= r.left && run->right >= r.right;
+		if (!covered)
+			return false;
+		y = run[-1].bottom;
+	}
+	return true;
+}
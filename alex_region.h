@@ -0,0 +1,98 @@
+#ifndef alex_region_DEFINED
+#define alex_region_DEFINED
+
+#include "include/GRect.h"
+#include "alex_arena.h"
+#include "alex_types.h"
+
+// rows [top, bottom) covered over [left, right)
+struct RegionRun {
+	int top;
+	int bottom;
+	int left;
+	int right;
+};
+
+/*
+ *  Set of device pixels stored as y-sorted bands. Runs are sorted by (top, left); runs in one
+ *  band share top and bottom, never touch or overlap, and vertically adjacent bands never have
+ *  identical intervals, so every region has exactly one representation. A rectangle needs no
+ *  storage; anything else lives in the arena passed to the operation that built it, and a
+ *  GRegion is a cheap value that must not outlive that arena.
+ */
+class GRegion {
+public:
+	enum Op {
+		kUnion,
+		kIntersect,
+		kDifference,	// a - b
+	};
+
+	GRegion() : fBounds(GIRect::LTRB(0, 0, 0, 0)) {}
+	explicit GRegion(const GIRect& r);
+
+	// Build a region from row spans sorted by (y, left) without overlap (e.g. a SpanList).
+	static GRegion FromSpans(const Span spans[], int count, Arena*);
+
+	// Linear in the number of runs of a and b.
+	static GRegion Combine(const GRegion& a, const GRegion& b, Op, Arena*);
+	static GRegion Union(const GRegion& a, const GRegion& b, Arena* arena) {
+		return Combine(a, b, kUnion, arena);
+	}
+	static GRegion Intersect(const GRegion& a, const GRegion& b, Arena* arena) {
+		return Combine(a, b, kIntersect, arena);
+	}
+	static GRegion Difference(const GRegion& a, const GRegion& b, Arena* arena) {
+		return Combine(a, b, kDifference, arena);
+	}
+
+	bool isEmpty() const { return fCount == 0; }
+	bool isRect() const { return fCount == 1; }
+	const GIRect& bounds() const { return fBounds; }
+
+	int count() const { return fCount; }
+	const RegionRun* begin() const { return fRuns ? fRuns : &fRect; }
+	const RegionRun* end() const { return this->begin() + fCount; }
+
+	// true if every pixel of r is in the region
+	bool contains(const GIRect& r) const;
+
+	// Call blit(y, L, R) for each piece of the span [left, right) on row y inside the region.
+	template <typename Blitter> void clipSpan(int y, int left, int right, Blitter&& blit) const {
+		if (y < fBounds.top || y >= fBounds.bottom)
+			return;
+		const RegionRun* run = this->findBand(y);
+		const RegionRun* stop = this->end();
+		if (run == stop || run->top > y)
+			return;
+		for (int top = run->top; run < stop && run->top == top && run->left < right; run++) {
+			int L = std::max(left, run->left);
+			int R = std::min(right, run->right);
+			if (L < R)
+				blit(y, L, R);
+		}
+	}
+
+private:
+	const RegionRun* fRuns = nullptr;	// null for a rect (or empty) region, which uses fRect
+	int fCount = 0;
+	GIRect fBounds;
+	RegionRun fRect;
+
+	// first run of the band containing y, or of the next band below it
+	const RegionRun* findBand(int y) const;
+
+	friend class RegionBuilder;
+};
+
+static inline bool irectsIntersect(const GIRect& a, const GIRect& b) {
+	return a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom;
+}
+
+// Smallest rect holding both. Empty rects are not special, so start from an inverted one.
+static inline GIRect unionIRects(const GIRect& a, const GIRect& b) {
+	return GIRect::LTRB(std::min(a.left, b.left), std::min(a.top, b.top),
+						std::max(a.right, b.right), std::max(a.bottom, b.bottom));
+}
+
+#endif
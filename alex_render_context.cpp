@@ -0,0 +1,17 @@
+#include "alex_render_context.h"
+
+static int workersFor(const RenderContext::Options& options) {
+	int threads = options.threads;
+	if (threads <= 0)
+		threads = (int)std::max(1u, std::thread::hardware_concurrency());
+	// the thread calling into the pool is one of them
+	return threads - 1;
+}
+
+RenderContext::RenderContext(const Options& options)
+	: fPool(workersFor(options), options.pinThreads) {}
+
+RenderContext* RenderContext::Default() {
+	static RenderContext* context = new RenderContext();
+	return context;
+}
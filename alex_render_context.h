@@ -0,0 +1,30 @@
+#ifndef alex_render_context_DEFINED
+#define alex_render_context_DEFINED
+
+#include "alex_thread_pool.h"
+
+/*
+ *  Resources shared by the canvases and jobs rendering in one process: for now the thread
+ *  pool that every parallel path (band rendering, tile playback, ...) runs on, so that they
+ *  never add up to more threads than the host was given.
+ */
+class RenderContext {
+public:
+	struct Options {
+		int threads = 0;			// threads working on a parallel loop, caller included; 0 = one per core
+		bool pinThreads = false;	// bind each worker to its own CPU
+	};
+
+	RenderContext() : RenderContext(Options()) {}
+	explicit RenderContext(const Options& options);
+
+	ThreadPool& pool() { return fPool; }
+
+	// Process-wide context with the default options, created on first use.
+	static RenderContext* Default();
+
+private:
+	ThreadPool fPool;
+};
+
+#endif
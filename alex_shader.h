@@ -59,6 +59,9 @@ public:
 	bool isOpaque() override {
 		return fBitmap.isOpaque();
 	}
+	std::shared_ptr<GShader> makeCopy() const override {
+		return std::make_shared<MyShader>(*this);
+	}
 	bool setContext(const GMatrix& ctm) override {
 		if (auto inv = (ctm * fLocalMatrix).invert()) {
 			fInverse = *inv;
@@ -0,0 +1,58 @@
+#include "alex_spans.h"
+
+void SpanList::grow() {
+	int capacity = std::max(64, fCapacity * 2);
+	Span* spans = fArena->makeArray<Span>(capacity);
+	if (fCount > 0)
+		memcpy(spans, fSpans, fCount * sizeof(Span));
+	// the old array stays in the arena until it is reset
+	fSpans = spans;
+	fCapacity = capacity;
+}
+
+GIRect SpanList::Bounds(const Span spans[], int count) {
+	if (count == 0)
+		return GIRect::LTRB(0, 0, 0, 0);
+	int left = spans[0].left;
+	int right = spans[0].right;
+	for (int i=1; i<count; i++) {
+		left = std::min(left, spans[i].left);
+		right = std::max(right, spans[i].right);
+	}
+	return GIRect::LTRB(left, spans[0].y, right, spans[count-1].y + 1);
+}
+
+void SpanList::offsetAndClip(int dx, int dy, const GIRect& clip, SpanList* dst) const {
+	assert(dst != this);
+	for (int i=0; i<fCount; i++) {
+		int y = fSpans[i].y + dy;
+		if (y < clip.top || y >= clip.bottom)
+			continue;
+		int L = std::max(fSpans[i].left + dx, clip.left);
+		int R = std::min(fSpans[i].right + dx, clip.right);
+		if (L < R)
+			dst->add(y, L, R);
+	}
+}
+
+void SpanList::Intersect(const Span a[], int aCount, const Span b[], int bCount, SpanList* dst) {
+	assert(dst->fSpans != a && dst->fSpans != b);
+	int i = 0;
+	int j = 0;
+	while (i < aCount && j < bCount) {
+		const Span& sa = a[i];
+		const Span& sb = b[j];
+		// advance whichever is behind, row first then x
+		if (sa.y != sb.y) {
+			if (sa.y < sb.y) i++;
+			else j++;
+			continue;
+		}
+		int L = std::max(sa.left, sb.left);
+		int R = std::min(sa.right, sb.right);
+		if (L < R)
+			dst->add(sa.y, L, R);
+		if (sa.right < sb.right) i++;
+		else j++;
+	}
+}
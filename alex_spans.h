@@ -0,0 +1,62 @@
+#ifndef alex_spans_DEFINED
+#define alex_spans_DEFINED
+
+#include "include/GRect.h"
+#include "alex_arena.h"
+#include "alex_types.h"
+
+/*
+ *  Run-length coverage produced by the scan converters: spans sorted by y, and by x within
+ *  a row, with no overlap. Storage comes from the arena, so a SpanList must not outlive it.
+ */
+class SpanList {
+public:
+	SpanList(Arena* arena) : fArena(arena) {}
+
+	// spans must be appended in (y, left) order
+	void add(int y, int left, int right) {
+		assert(left < right);
+		assert(fCount == 0 || y > fSpans[fCount-1].y ||
+			   (y == fSpans[fCount-1].y && left >= fSpans[fCount-1].right));
+		if (fCount == fCapacity)
+			this->grow();
+		fSpans[fCount++] = {y, left, right};
+	}
+
+	void reset() { fCount = 0; }
+
+	int count() const { return fCount; }
+	bool isEmpty() const { return fCount == 0; }
+	const Span* begin() const { return fSpans; }
+	const Span* end() const { return fSpans + fCount; }
+	const Span& operator[](int i) const { return fSpans[i]; }
+
+	// bounding box of all the spans (empty if there are none)
+	GIRect bounds() const { return Bounds(fSpans, fCount); }
+	static GIRect Bounds(const Span spans[], int count);
+
+	// dst = spans of this list offset by (dx, dy) and clipped to clip
+	void offsetAndClip(int dx, int dy, const GIRect& clip, SpanList* dst) const;
+
+	// dst = pixels covered by both a and b. dst must not be a or b.
+	static void Intersect(const SpanList& a, const SpanList& b, SpanList* dst) {
+		Intersect(a.fSpans, a.fCount, b.fSpans, b.fCount, dst);
+	}
+	static void Intersect(const Span a[], int aCount, const Span b[], int bCount, SpanList* dst);
+
+	// call blit(y, left, right) for each span
+	template <typename Blitter> void replay(Blitter&& blit) const {
+		for (int i=0; i<fCount; i++)
+			blit(fSpans[i].y, fSpans[i].left, fSpans[i].right);
+	}
+
+private:
+	Arena* fArena;
+	Span* fSpans = nullptr;
+	int fCount = 0;
+	int fCapacity = 0;
+
+	void grow();
+};
+
+#endif
@@ -0,0 +1,38 @@
+#include "alex_strip_render.h"
+#include "alex_recorder.h"
+#include "alex_canvas.h"
+#include <algorithm>
+#include <cstring>
+
+bool RenderInStrips(const DisplayList& list, const std::function<bool(const GBitmap& strip, int top)>& sink,
+					const StripRenderOptions& options) {
+	const int w = list.width();
+	const int h = list.height();
+	if (w <= 0 || h <= 0)
+		return false;
+	const int stripRows = std::max(1, std::min(options.stripRows, h));
+	GBitmap strip;
+	strip.alloc(w, stripRows);
+
+	bool ok = true;
+	for (int top=0; top<h && ok; top+=stripRows) {
+		const int rows = std::min(stripRows, h - top);
+		if (top > 0)
+			memset(strip.pixels(), 0, rows * strip.rowBytes());
+		// The strip holds device rows top.. of a w x h device. The canvases keep device
+		// coordinates, so geometry and shaders see exactly what a full device would.
+		GBitmap pixels(w, rows, strip.rowBytes(), strip.pixels(), false);
+		list.playbackTiled(CanvasDevice(pixels, 0, top, {w, h}), GIRect::LTRB(0, top, w, top + rows), options.context);
+		ok = sink(GBitmap(w, rows, strip.rowBytes(), strip.pixels(), false), top);
+	}
+	strip.release();
+	return ok;
+}
+
+bool RenderToPNG(const DisplayList& list, int fd, const StripRenderOptions& options, const PngEncodeOptions& png) {
+	PngWriter writer(fd, list.width(), list.height(), png);
+	auto write = [&](const GBitmap& strip, int) {
+		return writer.writeRows(strip);
+	};
+	return RenderInStrips(list, write, options) && writer.finished();
+}
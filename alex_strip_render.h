@@ -0,0 +1,32 @@
+#ifndef alex_strip_render_DEFINED
+#define alex_strip_render_DEFINED
+
+#include "include/GBitmap.h"
+#include "alex_png_encoder.h"
+#include <functional>
+
+class DisplayList;
+class RenderContext;
+
+struct StripRenderOptions {
+	// rows rendered at a time; the strip takes about width * 4 * stripRows bytes
+	int stripRows = 256;
+	// strips are drawn with playbackTiled on this context (RenderContext::Default() if null)
+	RenderContext* context = nullptr;
+};
+
+/*
+ *  Render list at its recorded size one horizontal strip at a time, into a single strip bitmap
+ *  that is cleared and reused for each, so memory depends on the width and not the height.
+ *  Each strip is handed to sink in order, with top its first device row; sink may keep nothing
+ *  that points into the strip. The pixels match playing list into one device-sized bitmap.
+ *  Returns false if list is empty or as soon as sink returns false.
+ */
+bool RenderInStrips(const DisplayList& list, const std::function<bool(const GBitmap& strip, int top)>& sink,
+					const StripRenderOptions& options = StripRenderOptions());
+
+// Render list to a PNG on fd, streaming each strip into a PngWriter as soon as it is drawn.
+bool RenderToPNG(const DisplayList& list, int fd, const StripRenderOptions& options = StripRenderOptions(),
+				 const PngEncodeOptions& png = PngEncodeOptions());
+
+#endif
@@ -0,0 +1,136 @@
+#include "alex_thread_pool.h"
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// the tasks of one parallel loop
+struct ThreadPool::Batch {
+	const std::function<void(int, int)>* fn;
+	std::atomic<int> remaining;
+};
+
+// the pool the current thread works for, and its queue there
+static thread_local const ThreadPool* tPool = nullptr;
+static thread_local int tWorker = -1;
+
+ThreadPool::ThreadPool(int workers, bool pinThreads) {
+	for (int i=0; i<workers; i++)
+		fQueues.push_back(std::make_unique<Queue>());
+	for (int i=0; i<workers; i++)
+		fWorkers.emplace_back(&ThreadPool::workerLoop, this, i, pinThreads);
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(fWakeMutex);
+		fStop = true;
+	}
+	fWake.notify_all();
+	for (std::thread& worker : fWorkers)
+		worker.join();
+}
+
+void ThreadPool::workerLoop(int index, bool pin) {
+#if defined(__linux__)
+	if (pin) {
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(index % std::max(1u, std::thread::hardware_concurrency()), &cpus);
+		pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+	}
+#endif
+	tPool = this;
+	tWorker = index;
+	for (;;) {
+		if (this->runOne(index))
+			continue;
+		std::unique_lock<std::mutex> lock(fWakeMutex);
+		fWake.wait(lock, [this] { return fStop || fQueued.load() > 0; });
+		if (fStop && fQueued.load() <= 0)
+			return;
+	}
+}
+
+void ThreadPool::push(int queue, const Task& task) {
+	{
+		std::lock_guard<std::mutex> lock(fQueues[queue]->mutex);
+		fQueues[queue]->tasks.push_back(task);
+	}
+	fQueued.fetch_add(1);
+	// taking the lock orders the count with a worker checking it before it sleeps
+	{
+		std::lock_guard<std::mutex> lock(fWakeMutex);
+	}
+	fWake.notify_one();
+}
+
+bool ThreadPool::runOne(int self) {
+	Task task;
+	bool found = false;
+	// newest of our own tasks first: its data is the most likely to still be in cache
+	if (self >= 0) {
+		Queue& own = *fQueues[self];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.tasks.empty()) {
+			task = own.tasks.back();
+			own.tasks.pop_back();
+			fQueued.fetch_sub(1);
+			found = true;
+		}
+	}
+	// then the oldest task of someone else
+	int n = (int)fQueues.size();
+	for (int k=1; !found && k<=n; k++) {
+		Queue& victim = *fQueues[(self + k + n) % n];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty()) {
+			task = victim.tasks.front();
+			victim.tasks.pop_front();
+			fQueued.fetch_sub(1);
+			found = true;
+		}
+	}
+	if (!found)
+		return false;
+	(*task.batch->fn)(task.begin, task.end);
+	// the batch may be gone once remaining reaches 0, so only the pool is touched after
+	if (task.batch->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		// wake the batch's caller if it is waiting for the last pieces
+		std::lock_guard<std::mutex> lock(fWakeMutex);
+		fWake.notify_all();
+	}
+	return true;
+}
+
+void ThreadPool::run(int begin, int end, int grain, const std::function<void(int, int)>& fn) {
+	int count = end - begin;
+	// a few tasks per thread, so stealing can even out pieces that take longer
+	int tasks = std::min(count / std::max(1, grain), 4 * this->concurrency());
+	if (fWorkers.empty() || tasks <= 1) {
+		fn(begin, end);
+		return;
+	}
+
+	Batch batch;
+	batch.fn = &fn;
+	batch.remaining.store(tasks);
+	int self = tPool == this ? tWorker : -1;
+	for (int t=0; t<tasks; t++) {
+		int lo = begin + (int)((long long)count * t / tasks);
+		int hi = begin + (int)((long long)count * (t + 1) / tasks);
+		int queue = self >= 0 ? self : (int)(fNextQueue.fetch_add(1) % fQueues.size());
+		this->push(queue, {&batch, lo, hi});
+	}
+	// Work on the loop (or anything else queued) until every piece has finished. With nothing
+	// left to run, sleep until the last piece finishes or more tasks are queued, e.g. by a
+	// nested loop inside one of the pieces still running.
+	while (batch.remaining.load(std::memory_order_acquire) > 0) {
+		if (this->runOne(self))
+			continue;
+		std::unique_lock<std::mutex> lock(fWakeMutex);
+		fWake.wait(lock, [&] {
+			return batch.remaining.load(std::memory_order_acquire) == 0 || fQueued.load() > 0;
+		});
+	}
+}
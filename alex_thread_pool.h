@@ -0,0 +1,75 @@
+#ifndef alex_thread_pool_DEFINED
+#define alex_thread_pool_DEFINED
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ *  Fixed set of worker threads with one task deque each. A worker pops its own newest task
+ *  and, when it runs dry, steals the oldest task of another worker. The thread that calls
+ *  parallelFor() works on the loop too, so nested loops never block waiting for a free worker.
+ *  With no workers everything runs on the calling thread, in order.
+ */
+class ThreadPool {
+public:
+	// pinThreads binds worker i to CPU i (Linux only; ignored elsewhere)
+	explicit ThreadPool(int workers, bool pinThreads = false);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	int workerCount() const { return (int)fWorkers.size(); }
+	// threads that run a parallelFor: the workers and the caller
+	int concurrency() const { return this->workerCount() + 1; }
+
+	// Call f(i) for every i in [0, count) and return once all calls have finished.
+	template <typename F> void parallelFor(int count, F&& f) {
+		this->parallelForRanges(0, count, 1, [&f](int begin, int end) {
+			for (int i=begin; i<end; i++)
+				f(i);
+		});
+	}
+
+	// Call f(lo, hi) over pieces of [begin, end) of at least grain items (e.g. row bands), and
+	// return once all calls have finished.
+	template <typename F> void parallelForRanges(int begin, int end, int grain, F&& f) {
+		if (begin >= end)
+			return;
+		std::function<void(int, int)> fn = std::forward<F>(f);
+		this->run(begin, end, grain, fn);
+	}
+
+private:
+	struct Batch;
+	struct Task {
+		Batch* batch;
+		int begin;
+		int end;
+	};
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	std::vector<std::thread> fWorkers;
+	std::vector<std::unique_ptr<Queue>> fQueues;	// one per worker
+	std::mutex fWakeMutex;
+	std::condition_variable fWake;	// tasks were queued, or a batch finished
+	std::atomic<int> fQueued{0};	// tasks in all queues
+	bool fStop = false;				// guarded by fWakeMutex
+	std::atomic<unsigned> fNextQueue{0};
+
+	void run(int begin, int end, int grain, const std::function<void(int, int)>&);
+	void push(int queue, const Task&);
+	bool runOne(int self);
+	void workerLoop(int index, bool pin);
+};
+
+#endif
@@ -0,0 +1,183 @@
+/*
+ *  Tile-parallel playback of display lists.
+ */
+#include "alex_recorder.h"
+#include "alex_canvas.h"
+#include "alex_render_context.h"
+#include <mutex>
+
+int DisplayList::shaderIndex(const Op* op) const {
+	switch (op->type) {
+		case OpType::kDrawRect:				return static_cast<const DrawRectOp*>(op)->paint.shader;
+		case OpType::kDrawConvexPolygon:	return static_cast<const DrawConvexPolygonOp*>(op)->paint.shader;
+		case OpType::kDrawPath:				return static_cast<const DrawPathOp*>(op)->paint.shader;
+		case OpType::kDrawMesh:				return static_cast<const DrawMeshOp*>(op)->paint.shader;
+		case OpType::kDrawQuad:				return static_cast<const DrawQuadOp*>(op)->paint.shader;
+		default:							return -1;
+	}
+}
+
+static bool rasterizable(DisplayList::OpType type) {
+	return type == DisplayList::OpType::kDrawRect || type == DisplayList::OpType::kDrawConvexPolygon ||
+		   type == DisplayList::OpType::kDrawPath;
+}
+
+/*
+ *  Two passes, both parallel:
+ *  1. Rect, polygon and path draws are scan converted once, by canvases that each replay the
+ *     state ops and rasterize one chunk of the draws.
+ *  2. Each tile replays the state ops into its own tile canvas and draws the ops binned to it,
+ *     blitting the spans from pass 1 where there are some.
+ *  A tile canvas clips and shades exactly as a full canvas would, so the result does not
+ *  depend on the tiling or on the order in which tiles finish.
+ */
+void DisplayList::playbackTiled(const GBitmap& device, RenderContext* context) const {
+	this->playbackTiled(device, GIRect::WH(device.width(), device.height()), context);
+}
+
+void DisplayList::playbackTiled(const GBitmap& device, const GIRect& area, RenderContext* context) const {
+	this->playbackTiled(CanvasDevice(device), area, context);
+}
+
+void DisplayList::playbackTiled(const CanvasDevice& device, const GIRect& area, RenderContext* context) const {
+	assert(device.holds(area) && area.left >= 0 && area.top >= 0 && area.right <= device.width() &&
+		   area.bottom <= device.height());
+	const int size = kPlaybackTileSize;
+	const int cols = (area.width() + size - 1) / size;
+	const int rows = (area.height() + size - 1) / size;
+	const int tileCount = area.isEmpty() ? 0 : cols * rows;
+	if (tileCount == 0 || fCount == 0)
+		return;
+	ThreadPool& pool = (context ? context : RenderContext::Default())->pool();
+
+	// Bounds start from area, so draws outside it come out empty and are skipped.
+	std::vector<OpBounds> ops;
+	this->computeBounds(area, &ops);
+	const int opCount = (int)ops.size();
+
+	// bin each draw into the tiles its bounds touch, in op order
+	std::vector<std::vector<int>> bins(tileCount);
+	int drawCount = 0;
+	for (int i=0; i<opCount; i++) {
+		const GIRect& b = ops[i].bounds;
+		if (!ops[i].isDraw || b.isEmpty())
+			continue;
+		drawCount += 1;
+		for (int ty = (b.top - area.top) / size; ty <= (b.bottom - 1 - area.top) / size; ty++) {
+			for (int tx = (b.left - area.left) / size; tx <= (b.right - 1 - area.left) / size; tx++)
+				bins[ty * cols + tx].push_back(i);
+		}
+	}
+
+	// To bring a canvas up to the state of op i, replay the state ops before it, skipping draws
+	// and save/restore pairs that close before i.
+	std::vector<int> nextState(opCount + 1, opCount);
+	std::vector<int> restoreOf(opCount, opCount);
+	std::vector<int> saves;
+	for (int i=opCount-1; i>=0; i--)
+		nextState[i] = ops[i].isDraw ? nextState[i + 1] : i;
+	for (int i=0; i<opCount; i++) {
+		if (ops[i].op->type == OpType::kSave) {
+			saves.push_back(i);
+		} else if (ops[i].op->type == OpType::kRestore && !saves.empty()) {
+			restoreOf[saves.back()] = i;
+			saves.pop_back();
+		}
+	}
+	auto replayTo = [&](MyCanvas* canvas, int i, int target) {
+		for (i = nextState[i]; i < target; i = nextState[i]) {
+			if (restoreOf[i] < target) {
+				i = restoreOf[i] + 1;
+			} else {
+				this->playOp(canvas, ops[i].op);
+				i += 1;
+			}
+		}
+	};
+
+	// pass 1: chunks of about the same number of draws
+	const int chunkCount = std::max(1, std::min(drawCount, 4 * pool.concurrency()));
+	std::vector<int> chunkEnd;
+	for (int i=0, seen=0; i<opCount; i++) {
+		if (ops[i].isDraw && !ops[i].bounds.isEmpty())
+			seen += 1;
+		if (seen * chunkCount >= ((int)chunkEnd.size() + 1) * drawCount || i == opCount - 1)
+			chunkEnd.push_back(i + 1);
+	}
+	std::vector<std::unique_ptr<Arena>> arenas(chunkEnd.size());
+	std::vector<SpanList> spans(opCount, SpanList(nullptr));
+	pool.parallelFor((int)chunkEnd.size(), [&](int c) {
+		arenas[c] = std::make_unique<Arena>();
+		// clipped to area's rows, so a strip costs only its own rows; not its columns, since
+		// shaders step along each span from its left edge and a cut span would shade differently
+		MyCanvas canvas(device, area);
+		canvas.clipRect(GRect::LTRB(0, area.top, device.width(), area.bottom));
+		int begin = c > 0 ? chunkEnd[c - 1] : 0;
+		replayTo(&canvas, 0, begin);
+		for (int i=begin; i<chunkEnd[c]; i++) {
+			const Op* op = ops[i].op;
+			if (!ops[i].isDraw) {
+				this->playOp(&canvas, op);
+				continue;
+			}
+			if (ops[i].bounds.isEmpty() || !rasterizable(op->type))
+				continue;
+			spans[i] = SpanList(arenas[c].get());
+			if (op->type == OpType::kDrawRect)
+				canvas.rasterizeRect(static_cast<const DrawRectOp*>(op)->rect, &spans[i]);
+			else if (op->type == OpType::kDrawConvexPolygon)
+				canvas.rasterizeConvexPolygon(static_cast<const DrawConvexPolygonOp*>(op)->points,
+											  static_cast<const DrawConvexPolygonOp*>(op)->count, &spans[i]);
+			else
+				canvas.rasterizePath(*fPaths[static_cast<const DrawPathOp*>(op)->path], &spans[i]);
+		}
+	});
+
+	// Shaders keep the context of their last setContext(), so each tile draws with copies of
+	// its own. A shader that can't be copied is shared, and the draws using it take turns.
+	std::mutex shaderLock;
+
+	// pass 2
+	pool.parallelFor(tileCount, [&](int t) {
+		const std::vector<int>& bin = bins[t];
+		if (bin.empty())
+			return;
+		int left = area.left + (t % cols) * size;
+		int top = area.top + (t / cols) * size;
+		int bottom = std::min(top + size, area.bottom);
+		MyCanvas canvas(device, GIRect::LTRB(left, top, std::min(left + size, area.right), bottom));
+		// Meshes and quads are rasterized here rather than in pass 1; clipping to the tile's rows
+		// skips their triangles above and below it. (Columns are left alone, as in pass 1.)
+		canvas.clipRect(GRect::LTRB(0, top, device.width(), bottom));
+		std::vector<std::shared_ptr<GShader>> shaders(fShaders.size());	// made on first use
+		std::vector<bool> shared(fShaders.size(), false);
+		int i = 0;
+		for (int draw : bin) {
+			replayTo(&canvas, i, draw);
+			i = draw + 1;
+			const Op* op = ops[draw].op;
+			std::unique_lock<std::mutex> lock(shaderLock, std::defer_lock);
+			int s = this->shaderIndex(op);
+			if (s >= 0) {
+				if (!shaders[s]) {
+					shaders[s] = fShaders[s]->makeCopy();
+					if (!shaders[s]) {
+						shaders[s] = fShaders[s];
+						shared[s] = true;
+					}
+				}
+				if (shared[s])
+					lock.lock();
+			}
+			if (rasterizable(op->type)) {
+				const Paint& paint = op->type == OpType::kDrawRect ? static_cast<const DrawRectOp*>(op)->paint :
+									 op->type == OpType::kDrawPath ? static_cast<const DrawPathOp*>(op)->paint :
+									 static_cast<const DrawConvexPolygonOp*>(op)->paint;
+				if (!spans[draw].isEmpty())
+					canvas.drawSpans(spans[draw], this->makePaint(paint, shaders.data()));
+			} else {
+				this->playOp(&canvas, op, shaders.data());
+			}
+		}
+	});
+}
@@ -21,6 +21,9 @@ public:
 	bool isOpaque() override {
 		return GPixel_GetA(fTrunk) == 0xFF && GPixel_GetA(fLeaves) == 0xFF;
 	}
+	std::shared_ptr<GShader> makeCopy() const override {
+		return std::make_shared<TreeShader>(*this);
+	}
 
 	bool setContext(const GMatrix& ctm) override {
 	 	if (auto inv = (ctm * fLocalMatrix).invert()) {
@@ -1,3 +1,6 @@
+#ifndef alex_types_DEFINED
+#define alex_types_DEFINED
+
 struct Edge {
 	float m;
 	float b;
@@ -13,4 +16,14 @@ struct Edge {
 	inline float computeX(int y) {
 		return m * (y + 0.5f) + b;
 	}
-};
\ No newline at end of file
+};
+
+// one horizontal run of covered pixels [left, right) on row y
+struct Span {
+	int y;
+	int left;
+	int right;
+};
+
+
+#endif
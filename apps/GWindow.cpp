@@ -42,7 +42,7 @@ GWindow::GWindow(int width, int height) {
 }
 
 GWindow::~GWindow() {
-    free(fBitmap.pixels());
+    fBitmap.release();
 }
 
 void GWindow::setTitle(const char title[]) {
@@ -137,11 +137,8 @@ bool GWindow::handleEvent(const SDL_Event& evt) {
 }
 
 void GWindow::setupBitmap(int w, int h) {
-    if (fBitmap.pixels()) {
-        free(fBitmap.pixels());
-    }
-    size_t rb = w * sizeof(GPixel);
-    fBitmap.reset(w, h, rb, (GPixel*)calloc(h, rb), GBitmap::kNo_IsOpaque);
+    fBitmap.release();
+    fBitmap.alloc(w, h, w * sizeof(GPixel));
 }
 
 static SDL_Rect make(const GIRect& r) {
@@ -0,0 +1,324 @@
+/**
+ *  Copyright 2015 Mike Reed
+ */
+
+#include "bench.h"
+#include "../include/GBitmap.h"
+#include "../include/GCanvas.h"
+#include "../include/GTime.h"
+#include "../alex_json.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+
+static bool is_arg(const char arg[], const char name[]) {
+    std::string str("--");
+    str += name;
+    if (!strcmp(arg, str.c_str())) {
+        return true;
+    }
+
+    char shortVers[3];
+    shortVers[0] = '-';
+    shortVers[1] = name[0];
+    shortVers[2] = 0;
+    return !strcmp(arg, shortVers);
+}
+
+// nanoseconds for loops calls of rec.fDraw
+static double time_loops(const GBenchRec& rec, GCanvas* canvas, int loops) {
+    GNSec start = GTime::GetNSec();
+    for (int i = 0; i < loops; ++i) {
+        rec.fDraw(canvas);
+    }
+    return (double)(GTime::GetNSec() - start);
+}
+
+// the value at fraction p (0..1) of sorted values, rounding the rank up
+static double percentile(const std::vector<double>& sorted, double p) {
+    size_t rank = (size_t)std::max(1.0, std::ceil(p * sorted.size()));
+    return sorted[std::min(rank, sorted.size()) - 1];
+}
+
+static double median(const std::vector<double>& sorted) {
+    size_t n = sorted.size();
+    return n & 1 ? sorted[n/2] : (sorted[n/2 - 1] + sorted[n/2]) / 2;
+}
+
+// median absolute deviation from the median: a spread that ignores a few outlier samples
+static double median_abs_dev(const std::vector<double>& sorted, double med) {
+    std::vector<double> dev;
+    for (double v : sorted) {
+        dev.push_back(std::fabs(v - med));
+    }
+    std::sort(dev.begin(), dev.end());
+    return median(dev);
+}
+
+static std::string format_ns(double ns) {
+    char buffer[32];
+    if (ns < 1e3) {
+        snprintf(buffer, sizeof(buffer), "%7.1fns", ns);
+    } else if (ns < 1e6) {
+        snprintf(buffer, sizeof(buffer), "%7.2fus", ns / 1e3);
+    } else {
+        snprintf(buffer, sizeof(buffer), "%7.2fms", ns / 1e6);
+    }
+    return buffer;
+}
+
+struct BenchResult {
+    std::string fName;
+    int         fLoops;
+    int         fSamples;
+    double      fMedianNS;      // per draw
+    double      fMADNS;
+    double      fP95NS;
+    double      fPixelsPerSec;
+};
+
+static bool read_file(const char path[], std::string* text) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+        text->append(buffer, n);
+    }
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+static bool write_file(const char path[], const std::string& text) {
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        return false;
+    }
+    bool ok = fwrite(text.data(), 1, text.size(), f) == text.size();
+    return fclose(f) == 0 && ok;
+}
+
+static void write_build_info(JSONWriter* w) {
+    w->beginObject("build");
+#if defined(__VERSION__)
+    w->value("compiler", __VERSION__);
+#endif
+#if defined(__x86_64__)
+    w->value("arch", "x86_64");
+#elif defined(__aarch64__)
+    w->value("arch", "arm64");
+#else
+    w->value("arch", "other");
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+    w->value("avx2", (bool)__builtin_cpu_supports("avx2"));
+#endif
+#if defined(__OPTIMIZE__)
+    w->value("optimized", true);
+#else
+    w->value("optimized", false);
+#endif
+#if defined(NDEBUG)
+    w->value("asserts", false);
+#else
+    w->value("asserts", true);
+#endif
+    w->value("hardwareThreads", (int)std::thread::hardware_concurrency());
+
+    char date[32];
+    time_t now = time(nullptr);
+    struct tm utc;
+    gmtime_r(&now, &utc);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", &utc);
+    w->value("date", date);
+    w->endObject();
+}
+
+static std::string results_to_json(const std::vector<BenchResult>& results, double minSampleMS) {
+    std::string out;
+    JSONWriter w(&out);
+    w.beginObject();
+    write_build_info(&w);
+    w.value("sampleMS", minSampleMS);
+    w.beginArray("cases");
+    for (const BenchResult& r : results) {
+        w.beginObject();
+        w.value("name", r.fName);
+        w.value("loops", r.fLoops);
+        w.value("samples", r.fSamples);
+        w.value("medianNS", r.fMedianNS);
+        w.value("madNS", r.fMADNS);
+        w.value("p95NS", r.fP95NS);
+        w.value("pixelsPerSec", r.fPixelsPerSec);
+        w.endObject();
+    }
+    w.endArray();
+    w.endObject();
+    out += "\n";
+    return out;
+}
+
+// Standard error of a median of samples with that MAD, taking the noise as roughly normal:
+// sigma is 1.4826 * MAD, and a median's error is 1.2533 * sigma / sqrt(samples).
+static double median_error(double mad, int samples) {
+    return 1.2533 * 1.4826 * mad / std::sqrt((double)std::max(1, samples));
+}
+
+/*
+ *  Compare results with the cases of a baseline file that have the same names. A case
+ *  regresses when its median is both more than threshold (a fraction) slower and slower by
+ *  more than 3 standard errors of the two medians, so that noise alone rarely trips it.
+ *  Returns the number of regressions, or -1 if the baseline can't be read.
+ */
+static int compare_to_baseline(const std::vector<BenchResult>& results, const char path[],
+                               double threshold, int nameLen) {
+    std::string text;
+    JSONValue baseline;
+    if (!read_file(path, &text) || !ParseJSON(text, &baseline)) {
+        fprintf(stderr, "can't read baseline %s\n", path);
+        return -1;
+    }
+    const JSONValue* cases = baseline.find("cases");
+    if (!cases || cases->type != JSONValue::Type::kArray) {
+        fprintf(stderr, "baseline %s has no cases\n", path);
+        return -1;
+    }
+
+    printf("\n%-*s %9s %9s %8s  vs %s\n", nameLen, "bench", "baseline", "now", "change", path);
+    int regressions = 0;
+    for (const BenchResult& r : results) {
+        const JSONValue* base = nullptr;
+        for (const JSONValue& c : cases->elements) {
+            if (c.stringAt("name", "") == r.fName) {
+                base = &c;
+            }
+        }
+        if (!base) {
+            printf("%-*s %9s %s %8s  new\n", nameLen, r.fName.c_str(), "-",
+                   format_ns(r.fMedianNS).c_str(), "");
+            continue;
+        }
+        double baseMedian = base->numberAt("medianNS", 0);
+        double baseMAD = base->numberAt("madNS", 0);
+        int baseSamples = (int)base->numberAt("samples", 1);
+        if (baseMedian <= 0) {
+            continue;
+        }
+
+        double change = r.fMedianNS / baseMedian - 1;
+        double error = std::sqrt(std::pow(median_error(r.fMADNS, r.fSamples), 2) +
+                                 std::pow(median_error(baseMAD, baseSamples), 2));
+        bool significant = std::fabs(r.fMedianNS - baseMedian) > 3 * error;
+        const char* verdict = "";
+        if (significant && change > threshold) {
+            verdict = "REGRESSION";
+            regressions += 1;
+        } else if (significant && change < -threshold) {
+            verdict = "faster";
+        }
+        printf("%-*s %s %s %+7.1f%%  %s\n", nameLen, r.fName.c_str(), format_ns(baseMedian).c_str(),
+               format_ns(r.fMedianNS).c_str(), change * 100, verdict);
+    }
+    printf("%d regression%s beyond %.1f%%\n", regressions, regressions == 1 ? "" : "s",
+           threshold * 100);
+    return regressions;
+}
+
+/*
+ *  Each case draws into its own device. The loop count is first doubled until one sample takes
+ *  at least minSampleMS, so timer resolution doesn't matter, then every sample runs that many
+ *  loops and records the time per draw.
+ *
+ *  --json writes the results to a file; --baseline compares them with such a file and exits
+ *  with 1 if any case regressed by more than --threshold percent (5 by default).
+ */
+int main_bench(int argc, const char* argv[]) {
+    const char* match = nullptr;
+    int samples = 25;
+    double minSampleMS = 2;
+    const char* jsonPath = nullptr;
+    const char* baselinePath = nullptr;
+    double threshold = 5;
+
+    for (int i = 1; i < argc; ++i) {
+        if (is_arg(argv[i], "match") && i+1 < argc) {
+            match = argv[++i];
+        } else if (is_arg(argv[i], "samples") && i+1 < argc) {
+            samples = std::max(1, atoi(argv[++i]));
+        } else if (is_arg(argv[i], "time") && i+1 < argc) {
+            minSampleMS = std::max(0.01, atof(argv[++i]));
+        } else if (is_arg(argv[i], "json") && i+1 < argc) {
+            jsonPath = argv[++i];
+        } else if (is_arg(argv[i], "baseline") && i+1 < argc) {
+            baselinePath = argv[++i];
+        } else if (is_arg(argv[i], "threshold") && i+1 < argc) {
+            threshold = std::max(0.0, atof(argv[++i]));
+        } else {
+            fprintf(stderr, "usage: %s [--match substring] [--samples count] [--time ms-per-sample]\n"
+                            "       [--json results.json] [--baseline results.json [--threshold percent]]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<GBenchRec> recs = GMakeBenchRecs();
+    size_t nameLen = 0;
+    for (const GBenchRec& rec : recs) {
+        nameLen = std::max(nameLen, rec.fName.size());
+    }
+    printf("%-*s %9s %9s %9s %9s %10s\n", (int)nameLen, "bench", "loops", "median", "mad", "p95",
+           "Mpix/s");
+
+    std::vector<BenchResult> results;
+
+    for (const GBenchRec& rec : recs) {
+        if (match && !strstr(rec.fName.c_str(), match)) {
+            continue;
+        }
+        GBitmap device;
+        device.alloc(rec.fSize.width, rec.fSize.height);
+        auto canvas = GCreateCanvas(device);
+
+        int loops = 1;
+        rec.fDraw(canvas.get());    // warm up caches and lazily built state
+        while (loops < (1 << 24) && time_loops(rec, canvas.get(), loops) < minSampleMS * 1e6) {
+            loops *= 2;
+        }
+
+        std::vector<double> perDraw(samples);
+        for (int s = 0; s < samples; ++s) {
+            perDraw[s] = time_loops(rec, canvas.get(), loops) / loops;
+        }
+        std::sort(perDraw.begin(), perDraw.end());
+        double med = median(perDraw);
+        double mad = median_abs_dev(perDraw, med);
+        double p95 = percentile(perDraw, 0.95);
+        printf("%-*s %9d %s %s %s %10.1f\n", (int)nameLen, rec.fName.c_str(), loops,
+               format_ns(med).c_str(), format_ns(mad).c_str(), format_ns(p95).c_str(),
+               rec.fPixels / med * 1e3);
+        fflush(stdout);
+        results.push_back({rec.fName, loops, samples, med, mad, p95, rec.fPixels / med * 1e9});
+        device.release();
+    }
+
+    if (jsonPath && !write_file(jsonPath, results_to_json(results, minSampleMS))) {
+        fprintf(stderr, "failed to write %s\n", jsonPath);
+        return 2;
+    }
+    if (baselinePath) {
+        int regressions = compare_to_baseline(results, baselinePath, threshold / 100, (int)nameLen);
+        if (regressions < 0) {
+            return 2;
+        }
+        return regressions > 0 ? 1 : 0;
+    }
+    return 0;
+}
@@ -0,0 +1,27 @@
+/**
+ *  Copyright 2015 Mike Reed
+ */
+
+#ifndef G_bench_DEFINED
+#define G_bench_DEFINED
+
+#include "../include/GPoint.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+class GCanvas;
+
+struct GBenchRec {
+    std::string                     fName;
+    GISize                          fSize;      // of the device drawn into
+    double                          fPixels;    // covered by one call of fDraw
+    std::function<void(GCanvas*)>   fDraw;
+};
+
+/*
+ *  Every benchmark case, in the order bench runs them.
+ */
+std::vector<GBenchRec> GMakeBenchRecs();
+
+#endif
@@ -0,0 +1,276 @@
+/**
+ *  Copyright 2015 Mike Reed
+ */
+
+#include "bench.h"
+#include "../include/GBitmap.h"
+#include "../include/GCanvas.h"
+#include "../include/GFinal.h"
+#include "../include/GPath.h"
+#include "../include/GPathBuilder.h"
+#include "../include/GRect.h"
+#include "../include/GShader.h"
+#include <cmath>
+#include <memory>
+
+static const char* gModeNames[] = {
+    "clear", "src", "dst", "srcover", "dstover", "srcin", "dstin", "srcout", "dstout",
+    "srcatop", "dstatop", "xor",
+};
+
+static const int gSizes[] = { 16, 256, 1024 };
+
+static std::string name_size(const char name[], int size) {
+    return std::string(name) + "_" + std::to_string(size);
+}
+
+// A colorful, partly transparent image, so bitmap shaders don't read a constant. Shaders only
+// point at its pixels, so it is never freed.
+static const GBitmap& bench_bitmap() {
+    static const GBitmap* bitmap = [] {
+        GBitmap* bm = new GBitmap;
+        bm->alloc(256, 256);
+        for (int y = 0; y < 256; ++y) {
+            for (int x = 0; x < 256; ++x) {
+                unsigned a = ((x >> 5) ^ (y >> 5)) & 1 ? 255 : 160;
+                *bm->getAddr(x, y) = GPixel_PackARGB(a, x * a / 255, y * a / 255, (x + y) / 2 * a / 255);
+            }
+        }
+        return bm;
+    }();
+    return *bitmap;
+}
+
+static std::shared_ptr<GShader> make_gradient(int size) {
+    const GColor colors[] = {
+        {1, 0, 0, 1}, {0, 1, 0, 0.5f}, {0, 0, 1, 1},
+    };
+    return GCreateLinearGradient({0, 0}, {(float)size, (float)size}, colors, 3);
+}
+
+static GPoint polar(float cx, float cy, float r, float radians) {
+    return { cx + r * cosf(radians), cy + r * sinf(radians) };
+}
+
+static void add_clear(std::vector<GBenchRec>* recs) {
+    for (int size : gSizes) {
+        recs->push_back({ name_size("clear", size), {size, size}, (double)size * size,
+                          [](GCanvas* canvas) { canvas->clear({0.25f, 0.5f, 0.75f, 0.5f}); } });
+    }
+}
+
+static void add_rects(std::vector<GBenchRec>* recs) {
+    for (int m = 0; m < (int)GARRAY_COUNT(gModeNames); ++m) {
+        const GBlendMode mode = (GBlendMode)m;
+        for (int size : gSizes) {
+            const GRect r = GRect::XYWH(0.5f, 0.5f, size - 1.0f, size - 1.0f);
+            const double pixels = (double)(size - 1) * (size - 1);
+
+            GPaint solid({0.8f, 0.4f, 0.2f, 0.6f});
+            solid.setBlendMode(mode);
+            recs->push_back({ name_size((std::string("rect_solid_") + gModeNames[m]).c_str(), size),
+                              {size, size}, pixels,
+                              [r, solid](GCanvas* canvas) { canvas->drawRect(r, solid); } });
+
+            GPaint shaded(make_gradient(size));
+            shaded.setBlendMode(mode);
+            recs->push_back({ name_size((std::string("rect_shader_") + gModeNames[m]).c_str(), size),
+                              {size, size}, pixels,
+                              [r, shaded](GCanvas* canvas) { canvas->drawRect(r, shaded); } });
+        }
+    }
+}
+
+static void add_polygons(std::vector<GBenchRec>* recs) {
+    for (int count : { 3, 16 }) {
+        for (int size : gSizes) {
+            std::vector<GPoint> pts;
+            for (int i = 0; i < count; ++i) {
+                pts.push_back(polar(size * 0.5f, size * 0.5f, size * 0.5f, i * 2 * (float)M_PI / count));
+            }
+            // area of the regular polygon inscribed in the circle
+            double pixels = 0.5 * count * (size * 0.5) * (size * 0.5) * sin(2 * M_PI / count);
+            std::string name = std::string("poly") + std::to_string(count);
+            GPaint paint({0.2f, 0.4f, 0.8f, 0.7f});
+            recs->push_back({ name_size(name.c_str(), size), {size, size}, pixels,
+                              [pts, paint](GCanvas* canvas) {
+                                  canvas->drawConvexPolygon(pts.data(), (int)pts.size(), paint);
+                              } });
+        }
+    }
+}
+
+static void add_paths(std::vector<GBenchRec>* recs) {
+    for (int size : gSizes) {
+        const float c = size * 0.5f;
+        const float r = size * 0.5f;
+        // a 7-point star, self-intersecting so the winding fill matters
+        auto lines = GPathBuilder::Build([&](GPathBuilder& bu) {
+            bu.moveTo(polar(c, c, r, 0));
+            for (int i = 1; i < 7; ++i) {
+                bu.lineTo(polar(c, c, r, i * 3 * 2 * (float)M_PI / 7));
+            }
+        });
+        // petals of quads and of cubics around the center
+        auto quads = GPathBuilder::Build([&](GPathBuilder& bu) {
+            bu.moveTo(polar(c, c, r * 0.3f, 0));
+            for (int i = 0; i < 8; ++i) {
+                float a = i * 2 * (float)M_PI / 8;
+                bu.quadTo(polar(c, c, r * 1.3f, a + (float)M_PI / 8), polar(c, c, r * 0.3f, a + (float)M_PI / 4));
+            }
+        });
+        auto cubics = GPathBuilder::Build([&](GPathBuilder& bu) {
+            bu.moveTo(polar(c, c, r * 0.3f, 0));
+            for (int i = 0; i < 8; ++i) {
+                float a = i * 2 * (float)M_PI / 8;
+                bu.cubicTo(polar(c, c, r, a + (float)M_PI / 16), polar(c, c, r, a + 3 * (float)M_PI / 16),
+                           polar(c, c, r * 0.3f, a + (float)M_PI / 4));
+            }
+        });
+        GPaint paint({0.3f, 0.7f, 0.2f, 0.8f});
+        const double pixels = (double)size * size;   // bounds; the shapes cover about half
+        recs->push_back({ name_size("path_lines", size), {size, size}, pixels,
+                          [lines, paint](GCanvas* canvas) { canvas->drawPath(*lines, paint); } });
+        recs->push_back({ name_size("path_quads", size), {size, size}, pixels,
+                          [quads, paint](GCanvas* canvas) { canvas->drawPath(*quads, paint); } });
+        recs->push_back({ name_size("path_cubics", size), {size, size}, pixels,
+                          [cubics, paint](GCanvas* canvas) { canvas->drawPath(*cubics, paint); } });
+    }
+}
+
+static void add_meshes(std::vector<GBenchRec>* recs) {
+    const int n = 8;    // grid cells per side, two triangles each
+    for (int size : { 256, 1024 }) {
+        std::vector<GPoint> verts, texs;
+        std::vector<GColor> colors;
+        for (int y = 0; y <= n; ++y) {
+            for (int x = 0; x <= n; ++x) {
+                verts.push_back({ (float)size * x / n, (float)size * y / n });
+                texs.push_back({ 256.0f * x / n, 256.0f * y / n });
+                colors.push_back({ (float)x / n, (float)y / n, 0.5f, 1 });
+            }
+        }
+        std::vector<int> indices;
+        for (int y = 0; y < n; ++y) {
+            for (int x = 0; x < n; ++x) {
+                int i = y * (n + 1) + x;
+                int tri[] = { i, i + 1, i + n + 1, i + 1, i + n + 2, i + n + 1 };
+                indices.insert(indices.end(), tri, tri + 6);
+            }
+        }
+        GPaint paint(GCreateBitmapShader(bench_bitmap(), GMatrix()));
+        const double pixels = (double)size * size;
+        recs->push_back({ name_size("mesh_colors", size), {size, size}, pixels,
+                          [=](GCanvas* canvas) {
+                              canvas->drawMesh(verts.data(), colors.data(), nullptr, 2 * n * n,
+                                               indices.data(), paint);
+                          } });
+        recs->push_back({ name_size("mesh_texs", size), {size, size}, pixels,
+                          [=](GCanvas* canvas) {
+                              canvas->drawMesh(verts.data(), nullptr, texs.data(), 2 * n * n,
+                                               indices.data(), paint);
+                          } });
+        recs->push_back({ name_size("mesh_both", size), {size, size}, pixels,
+                          [=](GCanvas* canvas) {
+                              canvas->drawMesh(verts.data(), colors.data(), texs.data(), 2 * n * n,
+                                               indices.data(), paint);
+                          } });
+    }
+}
+
+static void add_quads(std::vector<GBenchRec>* recs) {
+    const GColor colors[4] = { {1, 0, 0, 1}, {0, 1, 0, 1}, {0, 0, 1, 1}, {1, 1, 0, 0.5f} };
+    const GPoint texs[4] = { {0, 0}, {256, 0}, {256, 256}, {0, 256} };
+    GPaint paint(GCreateBitmapShader(bench_bitmap(), GMatrix()));
+    for (int level : { 2, 16 }) {
+        for (int size : { 256, 1024 }) {
+            const float s = (float)size;
+            // a bent quad, so the bilinear interpolation isn't affine
+            const GPoint verts[4] = { {0, 0}, {s, s * 0.1f}, {s * 0.9f, s}, {s * 0.05f, s * 0.8f} };
+            const double pixels = 0.85 * size * size;
+            std::string level_name = "_l" + std::to_string(level);
+            recs->push_back({ name_size(("quad_colors" + level_name).c_str(), size), {size, size}, pixels,
+                              [=](GCanvas* canvas) { canvas->drawQuad(verts, colors, nullptr, level, paint); } });
+            recs->push_back({ name_size(("quad_texs" + level_name).c_str(), size), {size, size}, pixels,
+                              [=](GCanvas* canvas) { canvas->drawQuad(verts, nullptr, texs, level, paint); } });
+            recs->push_back({ name_size(("quad_both" + level_name).c_str(), size), {size, size}, pixels,
+                              [=](GCanvas* canvas) { canvas->drawQuad(verts, colors, texs, level, paint); } });
+        }
+    }
+}
+
+static void add_shaders(std::vector<GBenchRec>* recs) {
+    auto final = std::shared_ptr<GFinal>(GCreateFinal());
+    const GColor colors[] = {
+        {1, 0, 0, 1}, {1, 1, 0, 1}, {0, 1, 0, 0.5f}, {0, 1, 1, 1}, {0, 0, 1, 1},
+    };
+    const float pos[] = { 0, 0.1f, 0.5f, 0.6f, 1 };
+    const GColorMatrix matrix({
+        0.5f, 0.2f, 0.1f, 0, 0,
+        0.1f, 0.6f, 0.1f, 0, 0,
+        0.2f, 0.1f, 0.5f, 0, 0,
+        0,    0,    0,    1, 0,
+    });
+
+    for (int size : gSizes) {
+        const float s = (float)size;
+        const GRect r = GRect::WH(s, s);
+        // each makes a shader for a device of this size
+        struct Maker {
+            const char* name;
+            std::function<std::shared_ptr<GShader>()> make;
+        };
+        std::shared_ptr<GShader> inner = make_gradient(size);
+        const Maker makers[] = {
+            { "bitmap_clamp", [&] { return GCreateBitmapShader(bench_bitmap(), GMatrix::Scale(0.7f, 0.7f)); } },
+            { "bitmap_repeat", [&] {
+                return GCreateBitmapShader(bench_bitmap(), GMatrix::Scale(0.7f, 0.7f), GTileMode::kRepeat);
+            } },
+            { "bitmap_mirror", [&] {
+                return GCreateBitmapShader(bench_bitmap(), GMatrix::Scale(0.7f, 0.7f), GTileMode::kMirror);
+            } },
+            { "bitmap_rotate", [&] {
+                return GCreateBitmapShader(bench_bitmap(), GMatrix::Rotate(0.3f) * GMatrix::Scale(0.7f, 0.7f),
+                                           GTileMode::kRepeat);
+            } },
+            { "linear2", [&] { return GCreateLinearGradient({0, 0}, {s, s}, colors[0], colors[4]); } },
+            { "linear5", [&] { return GCreateLinearGradient({0, 0}, {s, s}, colors, 5); } },
+            { "linear5_repeat", [&] {
+                return GCreateLinearGradient({s * 0.4f, 0}, {s * 0.6f, s * 0.1f}, colors, 5, GTileMode::kRepeat);
+            } },
+            { "linear5_mirror", [&] {
+                return GCreateLinearGradient({s * 0.4f, 0}, {s * 0.6f, s * 0.1f}, colors, 5, GTileMode::kMirror);
+            } },
+            { "sweep", [&] { return final->createSweepGradient({s / 2, s / 2}, 0.5f, colors, 5); } },
+            { "voronoi", [&] {
+                const GPoint pts[] = { {0, 0}, {s, s / 3}, {s / 2, s / 2}, {s / 4, s}, {s, s} };
+                return final->createVoronoiShader(pts, colors, 5);
+            } },
+            { "linearpos", [&] { return final->createLinearPosGradient({0, 0}, {s, s}, colors, pos, 5); } },
+            { "colormatrix", [&] { return final->createColorMatrixShader(matrix, inner.get()); } },
+        };
+        for (const Maker& maker : makers) {
+            std::shared_ptr<GShader> shader = maker.make();
+            if (!shader) {
+                continue;
+            }
+            GPaint paint(shader);
+            // the color matrix shader borrows inner, so the case keeps it alive
+            recs->push_back({ name_size((std::string("shader_") + maker.name).c_str(), size),
+                              {size, size}, (double)size * size,
+                              [r, paint, inner](GCanvas* canvas) { canvas->drawRect(r, paint); } });
+        }
+    }
+}
+
+std::vector<GBenchRec> GMakeBenchRecs() {
+    std::vector<GBenchRec> recs;
+    add_clear(&recs);
+    add_rects(&recs);
+    add_polygons(&recs);
+    add_paths(&recs);
+    add_meshes(&recs);
+    add_quads(&recs);
+    add_shaders(&recs);
+    return recs;
+}
@@ -6,57 +6,81 @@
 #include "../include/GCanvas.h"
 #include "../include/GColor.h"
 #include "../include/GBitmap.h"
+#include "../alex_canvas.h"
+#include "../alex_image_diff.h"
+#include <cstdarg>
 #include <string>
-
-static int pixel_diff(GPixel p0, GPixel p1) {
-    int da = abs(GPixel_GetA(p0) - GPixel_GetA(p1));
-    int dr = abs(GPixel_GetR(p0) - GPixel_GetR(p1));
-    int dg = abs(GPixel_GetG(p0) - GPixel_GetG(p1));
-    int db = abs(GPixel_GetB(p0) - GPixel_GetB(p1));
-    return std::max(da, std::max(dr, std::max(dg, db)));
+#include <vector>
+
+// Append printf-style text to out.
+static void appendf(std::string* out, const char format[], ...) {
+    char buffer[1024];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    *out += buffer;
 }
 
-static double compare(const GBitmap& a, const GBitmap& b, int tolerance, bool verbose) {
+static double compare(const GBitmap& a, const GBitmap& b, int tolerance, std::string* log) {
     assert(a.width() == b.width());
     assert(a.height() == b.height());
 
-    int total = 0;
-
-    const GPixel* rowA = a.pixels();
-    const GPixel* rowB = b.pixels();
-
-    int total_diff = 0;
-    int max_diff = 0;
-
-    for (int y = 0; y < a.height(); ++y) {
-        for (int x = 0; x < a.width(); ++x) {
-            // we don't score transparent pixels if both a and b are transparent (background)
-            if (!rowA[x] && !rowB[x]) {
-                continue;
-            }
-
-            int diff = pixel_diff(rowA[x], rowB[x]) - tolerance;
-            if (diff > 0) {
-                total_diff += diff;
-                max_diff = std::max(max_diff, diff);
-            }
-            total += 255;
-        }
-        rowA = (const GPixel*)((const char*)rowA + a.rowBytes());
-        rowB = (const GPixel*)((const char*)rowB + b.rowBytes());
-    }
+    // we don't score transparent pixels if both a and b are transparent (background)
+    ImageDiff diff = CompareBitmaps(a, b);
+    double total = 255.0 * diff.scored();
+    double total_diff = (double)diff.totalDiff(tolerance);
 
-    double score = 1.0 * (total - total_diff) / total;
+    double score = (total - total_diff) / total;
     assert(score >= 0 && score <= 1);
     score *= score;
-    if (verbose) {
-        printf(" score %3d", (int)(score * 100));
+    if (log) {
+        appendf(log, " score %3d", (int)(score * 100));
     }
     return score;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////
 
+static bool write_text(const std::string& path, const std::string& text) {
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) {
+        return false;
+    }
+    bool ok = fwrite(text.data(), 1, text.size(), f) == text.size();
+    return fclose(f) == 0 && ok;
+}
+
+/*
+ *  Draw rec again counting writes per pixel (the initial clear is not counted), and save
+ *  NAME_overdraw.png, a heatmap, and NAME_overdraw.json, the summary, into dir.
+ */
+static void handle_overdraw(const GDrawRec& rec, const char dir[], std::string* log) {
+    GBitmap bitmap;
+    bitmap.alloc(rec.fWidth, rec.fHeight);
+    MyCanvas canvas(bitmap);
+    canvas.clear({0, 0, 0, 0});
+
+    OverdrawMap overdraw(rec.fWidth, rec.fHeight);
+    canvas.setOverdraw(&overdraw);
+    rec.fDraw(&canvas);
+    bitmap.release();
+
+    std::string path(dir);
+    path += "/";
+    path += rec.fName;
+    path += "_overdraw";
+    if (!overdraw.writeHeatmap((path + ".png").c_str())) {
+        fprintf(stderr, "failed to write %s.png\n", path.c_str());
+    }
+    OverdrawMap::Summary summary = overdraw.summarize();
+    if (!write_text(path + ".json", summary.toJSON())) {
+        fprintf(stderr, "failed to write %s.json\n", path.c_str());
+    }
+    appendf(log, "overdraw: %s mean %.2f (%.2f where drawn) max %u\n",
+            rec.fName, summary.mean, summary.meanWritten, summary.max);
+}
+
 static void handle_proc(const GDrawRec& rec, const char path[], GBitmap* bitmap) {
     bitmap->alloc(rec.fWidth, rec.fHeight);
 
@@ -89,13 +113,13 @@ static bool is_arg(const char arg[], const char name[]) {
     return !strcmp(arg, shortVers);
 }
 
-static void add_image(FILE* f, const char path[], const char name[], const char suffix[],
+static void add_image(std::string* html, const char path[], const char name[], const char suffix[],
                       const GBitmap& bm) {
     std::string str(name);
     str += "__";
     str += suffix;
     str += ".png";
-    fprintf(f, "<a href=\"%s\"><img src=\"%s\" /></a>\n", str.c_str(), str.c_str());
+    appendf(html, "<a href=\"%s\"><img src=\"%s\" /></a>\n", str.c_str(), str.c_str());
 
     std::string full(path);
     full += "/";
@@ -103,30 +127,37 @@ static void add_image(FILE* f, const char path[], const char name[], const char
     bm.writeToFile(full.c_str());
 }
 
-static void add_diff_to_file(FILE* f, const GBitmap& test, const GBitmap& orig, const char path[],
-                             const char name[]) {
+// Write the test, orig and diff images into path, appending the html that shows them.
+static void add_diff_to_file(std::string* html, const GBitmap& test, const GBitmap& orig,
+                             const char path[], const char name[]) {
     const int w = test.width();
     const int h = test.height();
     GBitmap diff0, diff1;
     diff0.alloc(w, h);
     diff1.alloc(w, h);
 
-    for (int y = 0; y < h; ++y) {
-        for (int x = 0; x < w; ++x) {
-            int diff = pixel_diff(*test.getAddr(x, y), *orig.getAddr(x, y));
-            *diff0.getAddr(x, y) = GPixel_PackARGB(0xFF, diff, diff, diff);
-            if (diff > 0) {
-                diff = 0xFF;
+    RenderContext::Default()->pool().parallelForRanges(0, h, 64, [&](int top, int bottom) {
+        std::vector<uint8_t> diffs(w);
+        for (int y = top; y < bottom; ++y) {
+            PixelDiffRow(diffs.data(), test.getAddr(0, y), orig.getAddr(0, y), w);
+            GPixel* row0 = diff0.getAddr(0, y);
+            GPixel* row1 = diff1.getAddr(0, y);
+            for (int x = 0; x < w; ++x) {
+                int diff = diffs[x];
+                row0[x] = GPixel_PackARGB(0xFF, diff, diff, diff);
+                diff = diff > 0 ? 0xFF : 0;
+                row1[x] = GPixel_PackARGB(0xFF, diff, diff, diff);
             }
-            *diff1.getAddr(x, y) = GPixel_PackARGB(0xFF, diff, diff, diff);
         }
-    }
-
-    fprintf(f, "%s<br/>\n", name);
-    add_image(f, path, name, "test", test); fprintf(f, "&nbsp;&nbsp;");
-    add_image(f, path, name, "orig", orig); fprintf(f, "&nbsp;&nbsp;");
-    add_image(f, path, name, "dif0", diff0); fprintf(f, "&nbsp;&nbsp;");
-    add_image(f, path, name, "dif1", diff1); fprintf(f, "<br><br>\n");
+    });
+
+    appendf(html, "%s<br/>\n", name);
+    add_image(html, path, name, "test", test); *html += "&nbsp;&nbsp;";
+    add_image(html, path, name, "orig", orig); *html += "&nbsp;&nbsp;";
+    add_image(html, path, name, "dif0", diff0); *html += "&nbsp;&nbsp;";
+    add_image(html, path, name, "dif1", diff1); *html += "<br><br>\n";
+    diff0.release();
+    diff1.release();
 }
 
 static int gPACounts[10] = { 0,0,0,0,0,0,0,0,0,0 };
@@ -147,6 +178,7 @@ int main_image(int argc, const char* argv[]) {
     const char* expected = NULL;
     const char* diffDir = NULL;
     const char* scoreFile = nullptr;
+    const char* overdrawDir = nullptr;
     FILE* diffFile = NULL;
     int tolerance = 0;
 
@@ -174,6 +206,8 @@ int main_image(int argc, const char* argv[]) {
             assert(tolerance >= 0);
         } else if (is_arg(argv[i], "scoreFile") && i+1 < argc) {
             scoreFile = argv[++i];
+        } else if (is_arg(argv[i], "overdraw") && i+1 < argc) {
+            overdrawDir = argv[++i];
         } else if (is_arg(argv[i], "diff") && i+1 < argc) {
             diffDir = argv[++i];
             std::string path(diffDir);
@@ -201,9 +235,21 @@ int main_image(int argc, const char* argv[]) {
     // pa#_NAME.png -- so add 8 to the name length for the total
     const int maxNameLen = max_name_len() + 8;
 
+    // What a record prints and adds to the diff page, kept until every record before it
+    // has been printed, so the output is the same however the records were scheduled.
+    struct Result {
+        bool        ran = false;
+        std::string log;
+        std::string diffHTML;
+        double      weight = 0;
+        double      score = 0;
+    };
+    std::vector<Result> results(gDrawCount);
+
     double percent_correct = 0;
     double counter = 0;
     int numImages = 0;
+    std::vector<int> todo;
     for (int i = 0; gDrawRecs[i].fDraw; ++i) {
         numImages += 1;
 
@@ -222,39 +268,68 @@ int main_image(int argc, const char* argv[]) {
         if (match && !strstr(path.c_str(), match)) {
             continue;
         }
+        results[i].weight = weight;
+        todo.push_back(i);
+    }
+
+    // records draw on their own canvases, so several can run at once
+    RenderContext::Default()->pool().parallelFor((int)todo.size(), [&](int k) {
+        const int i = todo[k];
+        const GDrawRec& rec = gDrawRecs[i];
+        Result& result = results[i];
+        result.ran = true;
+
+        std::string path(root);
+        path += rec.fName;
+        path += ".png";
+        bool something = strncmp(rec.fName, "something_", strlen("something_")) == 0;
 
         if (verbose && !something) {
-            printf("image: [%2d] %*s", i, maxNameLen, path.c_str());
+            appendf(&result.log, "image: [%2d] %*s", i, maxNameLen, path.c_str());
         }
-        
+
         GBitmap testBM;
-        handle_proc(gDrawRecs[i], path.c_str(), &testBM);
+        handle_proc(rec, path.c_str(), &testBM);
 
         if (expected && !something) {
             std::string exp_path(expected);
             exp_path += "/";
-            exp_path += gDrawRecs[i].fName;
+            exp_path += rec.fName;
             exp_path += ".png";
             GBitmap expectedBM;
-    
+
             if (!expectedBM.readFromFile(exp_path.c_str())) {
-                printf("- failed to load <%s>", exp_path.c_str());
+                appendf(&result.log, "- failed to load <%s>", exp_path.c_str());
             } else {
-                double correct = compare(testBM, expectedBM, tolerance, verbose);
+                double correct = compare(testBM, expectedBM, tolerance, verbose ? &result.log : nullptr);
                 if (correct < 1 && diffFile != NULL) {
-                    add_diff_to_file(diffFile, testBM, expectedBM, diffDir, gDrawRecs[i].fName);
+                    add_diff_to_file(&result.diffHTML, testBM, expectedBM, diffDir, rec.fName);
                 }
-                double individual_score = correct * weight;
-
-                percent_correct += individual_score;
+                result.score = correct * result.weight;
             }
+            expectedBM.release();
         }
 
         if (verbose && !something) {
-            printf("\n");
+            result.log += "\n";
+        }
+
+        if (overdrawDir) {
+            handle_overdraw(rec, overdrawDir, &result.log);
         }
 
-        free(testBM.pixels());
+        testBM.release();
+    });
+
+    for (const Result& result : results) {
+        if (!result.ran) {
+            continue;
+        }
+        fputs(result.log.c_str(), stdout);
+        if (diffFile) {
+            fputs(result.diffHTML.c_str(), diffFile);
+        }
+        percent_correct += result.score;
     }
     if (diffFile) {
         fclose(diffFile);
@@ -0,0 +1,11 @@
+/**
+ *  Copyright 2023 Mike Reed
+ */
+
+#include <stdio.h>
+
+extern int main_bench(int argc, const char* argv[]);
+
+int main(int argc, const char* argv[]) {
+    return main_bench(argc, argv);
+}
@@ -0,0 +1,11 @@
+/**
+ *  Copyright 2023 Mike Reed
+ */
+
+#include <stdio.h>
+
+extern int main_tests(int argc, const char* argv[]);
+
+int main(int argc, const char* argv[]) {
+    return main_tests(argc, argv);
+}
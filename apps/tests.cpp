@@ -0,0 +1,28 @@
+/**
+ *  Copyright 2015 Mike Reed
+ */
+
+#include "tests.h"
+#include <string.h>
+
+// Run every test whose name contains the first argument (all of them if there is none).
+// Returns 1 if any check failed.
+int main_tests(int argc, const char* argv[]) {
+    const char* match = argc > 1 ? argv[1] : nullptr;
+
+    int tests = 0;
+    int failed = 0;
+    for (int i = 0; gTestRecs[i].fProc; ++i) {
+        if (match && !strstr(gTestRecs[i].fName, match)) {
+            continue;
+        }
+        GTestStats stats;
+        stats.fName = gTestRecs[i].fName;
+        gTestRecs[i].fProc(&stats);
+        printf("%-28s %d checks%s\n", stats.fName, stats.fChecks, stats.fFailures ? ", FAILED" : "");
+        tests += 1;
+        failed += stats.fFailures > 0;
+    }
+    printf("%d of %d tests passed\n", tests - failed, tests);
+    return failed ? 1 : 0;
+}
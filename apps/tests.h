@@ -0,0 +1,35 @@
+/**
+ *  Copyright 2015 Mike Reed
+ */
+
+#ifndef G_tests_DEFINED
+#define G_tests_DEFINED
+
+#include <stdio.h>
+
+struct GTestStats {
+    const char* fName = nullptr;
+    int         fChecks = 0;
+    int         fFailures = 0;
+
+    // Count a check, printing msg if pred is false.
+    void expect(bool pred, const char msg[]) {
+        fChecks += 1;
+        if (!pred) {
+            fFailures += 1;
+            printf("    %s: FAILED %s\n", fName, msg);
+        }
+    }
+};
+
+struct GTestRec {
+    void        (*fProc)(GTestStats*);
+    const char* fName;
+};
+
+/*
+ *  Array is terminated when fProc is NULL
+ */
+extern const GTestRec gTestRecs[];
+
+#endif
@@ -0,0 +1,238 @@
+/**
+ *  Copyright 2015 Mike Reed
+ */
+
+#include "tests.h"
+#include "../include/GBitmap.h"
+#include "../include/GCanvas.h"
+#include "../include/GPaint.h"
+#include "../include/GPathBuilder.h"
+#include "../include/GRect.h"
+#include "../include/GRandom.h"
+#include "../alex_pixel_convert.h"
+#include "../alex_recorder.h"
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+static int count_diffs(const GBitmap& a, const GBitmap& b) {
+    int diffs = 0;
+    for (int y = 0; y < a.height(); ++y) {
+        for (int x = 0; x < a.width(); ++x) {
+            diffs += *a.getAddr(x, y) != *b.getAddr(x, y);
+        }
+    }
+    return diffs;
+}
+
+// Draw into a bitmap directly and through a culled recording; the two must match.
+static void check_culled(GTestStats* stats, int w, int h, const std::function<void(GCanvas*)>& draw,
+                         int expectedFolds) {
+    GBitmap direct, played;
+    direct.alloc(w, h);
+    played.alloc(w, h);
+    draw(GCreateCanvas(direct).get());
+
+    RecordingCanvas recorder(w, h);
+    draw(&recorder);
+    auto list = recorder.finishRecording();
+    DisplayList::CullStats cull = list->cullOverdraw();
+    list->playback(GCreateCanvas(played).get());
+
+    stats->expect(cull.folded == expectedFolds, "folded count");
+    stats->expect(count_diffs(direct, played) == 0, "culled playback matches direct drawing");
+}
+
+static void test_cull_fold(GTestStats* stats) {
+    GPaint paint(GColor::RGBA(1, 0, 0, 1));
+    paint.setBlendMode(GBlendMode::kSrc);
+
+    // an axis aligned rect over the whole canvas is a clear
+    check_culled(stats, 100, 100, [&](GCanvas* canvas) {
+        canvas->drawRect(GRect::WH(100, 100), paint);
+    }, 1);
+
+    // rotated, its bounding box still covers the canvas but the corners are left alone
+    check_culled(stats, 100, 100, [&](GCanvas* canvas) {
+        canvas->translate(50, 50);
+        canvas->rotate(0.5f);
+        canvas->translate(-50, -50);
+        canvas->drawRect(GRect::WH(100, 100), paint);
+    }, 0);
+
+    // so are the corners outside a round clip whose bounds cover the canvas
+    check_culled(stats, 100, 100, [&](GCanvas* canvas) {
+        GPathBuilder bu;
+        bu.addCircle({50, 50}, 60);
+        canvas->clipPath(*bu.detach());
+        canvas->drawRect(GRect::WH(100, 100), paint);
+    }, 0);
+}
+
+static void test_pixel_pool(GTestStats* stats) {
+    const GBitmap::PixelPoolStats start = GBitmap::GetPixelPoolStats();
+
+    // the same size over and over reuses one buffer
+    for (int i = 0; i < 100; ++i) {
+        GBitmap bm;
+        bm.alloc(300, 200);
+        bm.release();
+    }
+    GBitmap::PixelPoolStats s = GBitmap::GetPixelPoolStats();
+    stats->expect(s.liveBuffers == start.liveBuffers, "released buffers are no longer live");
+    stats->expect(s.pooledBuffers <= start.pooledBuffers + 1, "churn pools a single buffer");
+
+    // many sizes at once stay within a small budget
+    const size_t budget = 1 << 20;
+    GBitmap::SetPixelPoolBudget(budget);
+    stats->expect(GBitmap::GetPixelPoolStats().pooledBytes <= budget, "lowering the budget evicts");
+    GBitmap bitmaps[40];
+    for (int i = 0; i < 40; ++i) {
+        bitmaps[i].alloc(64 + 16 * i, 100);
+    }
+    stats->expect(GBitmap::GetPixelPoolStats().liveBuffers == start.liveBuffers + 40, "allocs are live");
+    for (GBitmap& bm : bitmaps) {
+        bm.release();
+        s = GBitmap::GetPixelPoolStats();
+        if (s.pooledBytes > budget) {
+            break;
+        }
+    }
+    stats->expect(s.pooledBytes <= budget, "pool stays within its budget");
+    stats->expect(s.liveBuffers == start.liveBuffers, "every buffer was released");
+
+    // larger than the whole budget: freed, not pooled
+    GBitmap big;
+    big.alloc(1024, 1024);
+    size_t pooled = GBitmap::GetPixelPoolStats().pooledBuffers;
+    big.release();
+    stats->expect(GBitmap::GetPixelPoolStats().pooledBuffers == pooled, "oversized buffer is freed");
+
+    // pixels the pool never handed out are left to their owner
+    GPixel storage[16 * 4] = {};
+    GBitmap wrapped;
+    wrapped.reset(16, 4, 16 * sizeof(GPixel), storage, GBitmap::kNo_IsOpaque);
+    s = GBitmap::GetPixelPoolStats();
+    wrapped.release();
+    const GBitmap::PixelPoolStats after = GBitmap::GetPixelPoolStats();
+    stats->expect(!wrapped.pixels(), "releasing wrapped pixels resets the bitmap");
+    stats->expect(after.liveBuffers == s.liveBuffers && after.pooledBuffers == s.pooledBuffers,
+                  "wrapped pixels are not pooled");
+
+    GBitmap::SetPixelPoolBudget(start.budgetBytes);
+}
+
+// GPixel_PackARGB without its checks, so colors may exceed alpha
+static GPixel pack_any(unsigned a, unsigned r, unsigned g, unsigned b) {
+    return (a << GPIXEL_SHIFT_A) | (r << GPIXEL_SHIFT_R) | (g << GPIXEL_SHIFT_G) | (b << GPIXEL_SHIFT_B);
+}
+
+static void test_unpremul(GTestStats* stats) {
+    // every alpha, with colors up to and past it, in rows long enough for the vector loops
+    std::vector<GPixel> pixels;
+    for (int a = 0; a < 256; ++a) {
+        for (int c : { 0, a / 3, a, a + 1, 255 }) {
+            c = std::min(c, 255);
+            pixels.push_back(pack_any(a, c, std::min(255, a + 7), c / 2));
+        }
+    }
+    GRandom rand(7);
+    for (int i = 0; i < 4096; ++i) {
+        pixels.push_back(rand.nextU());
+    }
+
+    const int n = (int)pixels.size();
+    std::vector<uint8_t> row(4 * n), single(4 * n);
+    UnpremulToRGBA(row.data(), pixels.data(), n);
+    // one at a time only ever runs the scalar code
+    for (int i = 0; i < n; ++i) {
+        UnpremulToRGBA(&single[4 * i], &pixels[i], 1);
+    }
+    int mismatches = 0;
+    for (int i = 0; i < 4 * n; ++i) {
+        mismatches += row[i] != single[i];
+    }
+    stats->expect(mismatches == 0, "vector unpremul matches scalar");
+
+    // an invalid pixel saturates instead of spilling into its neighbors
+    GPixel bad = pack_any(10, 200, 0, 0);
+    uint8_t rgba[4];
+    UnpremulToRGBA(rgba, &bad, 1);
+    stats->expect(rgba[0] == 255 && rgba[1] == 0 && rgba[2] == 0 && rgba[3] == 10, "color above alpha saturates");
+}
+
+// Meshes and quads are rasterized per tile; tiled playback must still match drawing directly.
+static void test_tiled_mesh(GTestStats* stats) {
+    const int w = 300, h = 260;
+    auto draw = [](GCanvas* canvas) {
+        const GPoint quad[] = {{10, 5}, {290, 20}, {270, 250}, {5, 230}};
+        const GColor colors[] = {{1, 1, 0, 0}, {1, 0, 1, 0}, {0.5f, 0, 0, 1}, {1, 1, 1, 0}};
+        canvas->drawQuad(quad, colors, nullptr, 12, GPaint());
+
+        // a textured mesh under a rotation, across many tiles at once
+        GPaint paint(GCreateLinearGradient({0, 0}, {1, 1}, {1, 0, 0.5f, 1}, {0.75f, 1, 1, 0}));
+        const GPoint verts[] = {{20, 20}, {280, 40}, {150, 240}, {30, 200}};
+        const GPoint texs[] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+        const int indices[] = {0, 1, 2, 0, 2, 3};
+        canvas->save();
+        canvas->concat(GMatrix::Rotate(0.2f));
+        canvas->drawMesh(verts, nullptr, texs, 2, indices, paint);
+        canvas->restore();
+    };
+
+    GBitmap direct, tiled;
+    direct.alloc(w, h);
+    tiled.alloc(w, h);
+    draw(GCreateCanvas(direct).get());
+    RecordingCanvas recorder(w, h);
+    draw(&recorder);
+    recorder.finishRecording()->playbackTiled(tiled);
+    stats->expect(count_diffs(direct, tiled) == 0, "tiled meshes match direct drawing");
+
+    direct.release();
+    tiled.release();
+}
+
+// Restores without a matching save are not recorded, so playback never pops state it didn't push.
+static void test_unmatched_restore(GTestStats* stats) {
+    GPaint red({1, 1, 0, 0}), blue({1, 0, 0, 1});
+    RecordingCanvas recorder(40, 40);
+    recorder.restore();
+    recorder.save();
+    recorder.concat(GMatrix::Translate(10, 10));
+    recorder.drawRect(GRect::WH(10, 10), red);
+    recorder.restore();
+    recorder.restore();
+    recorder.drawRect(GRect::XYWH(25, 25, 10, 10), blue);
+    auto list = recorder.finishRecording();
+    stats->expect(list->count() == 5, "unmatched restores are dropped");
+
+    GBitmap direct, played;
+    direct.alloc(40, 40);
+    played.alloc(40, 40);
+    {
+        auto canvas = GCreateCanvas(direct);
+        canvas->translate(5, 0);
+        canvas->save();
+        canvas->concat(GMatrix::Translate(10, 10));
+        canvas->drawRect(GRect::WH(10, 10), red);
+        canvas->restore();
+        canvas->drawRect(GRect::XYWH(25, 25, 10, 10), blue);
+    }
+    // the extra restores must not undo the playback's own translate
+    list->playback(GCreateCanvas(played).get(), GMatrix::Translate(5, 0));
+    stats->expect(count_diffs(direct, played) == 0, "playback keeps the caller's state");
+
+    direct.release();
+    played.release();
+}
+
+const GTestRec gTestRecs[] = {
+    { test_cull_fold,         "cull_fold" },
+    { test_pixel_pool,        "pixel_pool" },
+    { test_unpremul,          "unpremul" },
+    { test_tiled_mesh,        "tiled_mesh" },
+    { test_unmatched_restore, "unmatched_restore" },
+
+    { nullptr, nullptr },
+};
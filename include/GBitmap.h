@@ -57,8 +57,8 @@ public:
     /**
      *  Attempt to read the png image stored in the named file.
      *
-     *  On success, allocate the memory for the pixels using malloc() and set bitmap to the result,
-     *  returning true. The caller must call free(bitmap->fPixels) when they are finished.
+     *  On success, allocate the memory for the pixels using alloc() and set bitmap to the result,
+     *  returning true. The caller must call release() when they are finished.
      *
      *  This automatically computes the opaqueness of the bitmap.
      *
@@ -72,11 +72,46 @@ public:
      */
     bool writeToFile(const char path[]) const;
 
+    /*
+     *  Write the bitmap as a PNG to an open file descriptor, with EncodePNG's default options
+     *  (strips compressed in parallel on the default render context). Return true on success.
+     */
+    bool writeToFD(int fd) const;
+
     /**
-     *  Allocate the memory for the bitmap. If rowBytes is 0, it will be computed from w.
+     *  Allocate the memory for the bitmap, zeroed and 64-byte aligned. If rowBytes is 0, it
+     *  will be computed from w (see DefaultRowBytes).
      */
     void alloc(int w, int h, size_t rowBytes = 0);
 
+    /**
+     *  Give memory from alloc() or readFromFile() back to be reused by a later alloc() of about
+     *  the same size, and reset to empty. Pixels from anywhere else (wrapped with reset() or
+     *  mapped) are not the bitmap's to free: they are left alone, and only the bitmap is reset.
+     *  Pixels from alloc() must not be freed any other way.
+     */
+    void release();
+
+    /**
+     *  Row bytes alloc() uses for width w: rounded up to a multiple of 64, plus 64 more when
+     *  that is a multiple of 1K, so rows don't alias in the cache.
+     */
+    static size_t DefaultRowBytes(int w);
+
+    /**
+     *  Released buffers wait in the pool for reuse, up to a budget of bytes (256MB to start
+     *  with); the oldest are freed to stay within it. Lowering the budget frees buffers now.
+     */
+    static void SetPixelPoolBudget(size_t bytes);
+
+    struct PixelPoolStats {
+        size_t liveBuffers;     // from alloc(), not yet released
+        size_t pooledBuffers;   // released, waiting to be reused
+        size_t pooledBytes;
+        size_t budgetBytes;
+    };
+    static PixelPoolStats GetPixelPoolStats();
+
 private:
     int     fWidth;
     int     fHeight;
@@ -19,7 +19,7 @@ public:
     virtual ~GCanvas() {}
 
     /**
-     *  Save off a copy of the canvas state (CTM), to be later used if the balancing call to
+     *  Save off a copy of the canvas state (CTM and clip), to be later used if the balancing call to
      *  restore() is made. Calls to save/restore can be nested:
      *  save();
      *      save();
@@ -32,7 +32,7 @@ public:
     virtual void save() = 0;
 
     /**
-     *  Copy the canvas state (CTM) that was record in the correspnding call to save() back into
+     *  Copy the canvas state (CTM and clip) that was record in the correspnding call to save() back into
      *  the canvas. It is an error to call restore() if there has been no previous call to save().
      */
     virtual void restore() = 0;
@@ -46,7 +46,19 @@ public:
     virtual void concat(const GMatrix& matrix) = 0;
 
     /**
-     *  Fill the entire canvas with the specified color, using kSrc porter-duff mode.
+     *  Intersect the current clip with the rectangle, transformed by the CTM. Subsequent draws
+     *  only affect pixels inside the clip, using the same "containment" rule as drawRect.
+     *  The canvas is constructed with a clip covering the whole device.
+     */
+    virtual void clipRect(const GRect&) = 0;
+
+    /**
+     *  Intersect the current clip with the path (non-zero winding), transformed by the CTM.
+     */
+    virtual void clipPath(const GPath&) = 0;
+
+    /**
+     *  Fill the entire clip with the specified color, using kSrc porter-duff mode.
      */
     virtual void clear(const GColor&) = 0;
 
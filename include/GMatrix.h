@@ -19,11 +19,13 @@ public:
     GMatrix(float a, float c, float e, float b, float d, float f) {
         fMat[0] = a;    fMat[2] = c;    fMat[4] = e;
         fMat[1] = b;    fMat[3] = d;    fMat[5] = f;
+        fTypeMask = this->computeTypeMask();
     }
 
     GMatrix(GVector e0, GVector e1, GVector origin) {
         fMat[0] = e0.x;    fMat[2] = e1.x;    fMat[4] = origin.x;
         fMat[1] = e0.y;    fMat[3] = e1.y;    fMat[5] = origin.y;
+        fTypeMask = this->computeTypeMask();
     }
 
     GMatrix(const GMatrix& other) = default;
@@ -36,11 +38,32 @@ public:
         assert(index >= 0 && index < 6);
         return fMat[index];
     }
-    float& operator[](int index) {
+    // Writes go through set(), which keeps the type mask current; reads never modify the matrix.
+    void set(int index, float value) {
         assert(index >= 0 && index < 6);
-        return fMat[index];
+        fMat[index] = value;
+        fTypeMask = this->computeTypeMask();
     }
 
+    /**
+     *  Bits describing which parts of the matrix are not trivial. A matrix with none set is the
+     *  identity; one without kAffine_Mask keeps rects axis aligned.
+     */
+    enum TypeMask {
+        kIdentity_Mask  = 0,
+        kTranslate_Mask = 1 << 0,   // e or f != 0
+        kScale_Mask     = 1 << 1,   // a or d != 1
+        kAffine_Mask    = 1 << 2,   // b or c != 0 (skew or rotation)
+    };
+
+    /**
+     *  Return the TypeMask bits for this matrix. The mask is computed whenever the matrix is
+     *  constructed or set, so reading it is safe from any number of threads.
+     */
+    unsigned getType() const { return fTypeMask; }
+    bool isIdentity() const { return this->getType() == kIdentity_Mask; }
+    bool isScaleTranslate() const { return !(this->getType() & kAffine_Mask); }
+
     bool operator==(const GMatrix& m) {
         for (int i = 0; i < 6; ++i) {
             if (fMat[i] != m.fMat[i]) {
@@ -85,6 +108,12 @@ public:
      */
     void mapPoints(GPoint dst[], const GPoint src[], int count) const;
 
+    /**
+     *  Same as mapPoints, but for points stored as separate x and y arrays. dstX/dstY may be
+     *  the same arrays as srcX/srcY.
+     */
+    void mapXY(float dstX[], float dstY[], const float srcX[], const float srcY[], int count) const;
+
     ///////////////////////////////////////////////////////////////////////////////////////////////
     // These helper methods are implemented in terms of the previous methods.
 
@@ -92,10 +121,15 @@ public:
         return Concat(a, b);
     }
 
+    // In-place mapping; the mapping kernels read each batch before writing it.
     void mapPoints(GPoint pts[], int count) const {
         this->mapPoints(pts, pts, count);
     }
 
+    void mapXY(float x[], float y[], int count) const {
+        this->mapXY(x, y, x, y, count);
+    }
+
     GPoint operator*(GPoint p) const {
         this->mapPoints(&p, 1);
         return p;
@@ -103,6 +137,21 @@ public:
 
 private:
     float fMat[6];
+    uint8_t fTypeMask;
+
+    unsigned computeTypeMask() const {
+        unsigned mask = kIdentity_Mask;
+        if (fMat[4] != 0 || fMat[5] != 0) {
+            mask |= kTranslate_Mask;
+        }
+        if (fMat[0] != 1 || fMat[3] != 1) {
+            mask |= kScale_Mask;
+        }
+        if (fMat[1] != 0 || fMat[2] != 0) {
+            mask |= kAffine_Mask;
+        }
+        return mask;
+    }
 };
 
 #endif
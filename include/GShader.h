@@ -38,6 +38,13 @@ public:
      *  can hold at least [count] entries.
      */
     virtual void shadeRow(int x, int y, int count, GPixel row[]) = 0;
+
+    /**
+     *  Return a new shader that draws exactly as this one does but keeps its own context, so
+     *  the two can be set up and shaded on different threads. Returns null if the shader can
+     *  not be copied, which is the default.
+     */
+    virtual std::shared_ptr<GShader> makeCopy() const { return nullptr; }
 };
 
 /**
@@ -3,6 +3,10 @@
  */
 
 #include "../include/GBitmap.h"
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 void GBitmap::setIsOpaque(IsOpaque io) {
     switch (io) {
@@ -33,17 +37,144 @@ bool GBitmap::ComputeIsOpaque(const GBitmap& bm) {
     return true;
 }
 
+/*
+ *  Pixel memory comes from posix_memalign, so free() still works on it, but release() hands it
+ *  to this pool instead. Buffers are kept by size class (a quarter of a power of two), so the
+ *  next alloc() of a similar size reuses pages that are already mapped.
+ */
+namespace {
+class PixelPool {
+public:
+    static PixelPool& Get() {
+        static PixelPool* pool = new PixelPool;    // leaked: bitmaps may outlive statics
+        return *pool;
+    }
+
+    static size_t SizeClass(size_t bytes) {
+        size_t step = 64;
+        while (step * 8 <= bytes) {
+            step *= 2;
+        }
+        return (bytes + step - 1) & ~(step - 1);
+    }
+
+    void* acquire(size_t bytes) {
+        size_t size = SizeClass(bytes);
+        void* p = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            for (size_t i = fFree.size(); i-- > 0;) {
+                if (fFree[i].size == size) {
+                    p = fFree[i].ptr;
+                    fPooledBytes -= size;
+                    fFree.erase(fFree.begin() + i);
+                    break;
+                }
+            }
+        }
+        if (!p && posix_memalign(&p, kAlign, size) != 0) {
+            return nullptr;
+        }
+        memset(p, 0, bytes);
+        std::lock_guard<std::mutex> lock(fMutex);
+        fLive[p] = size;
+        return p;
+    }
+
+    // Returns false, leaving p alone, if p did not come from acquire().
+    bool release(void* p) {
+        std::lock_guard<std::mutex> lock(fMutex);
+        auto it = fLive.find(p);
+        if (it == fLive.end()) {
+            return false;
+        }
+        size_t size = it->second;
+        fLive.erase(it);
+        if (size > fBudget) {
+            free(p);
+            return true;
+        }
+        // make room first, so the pool never holds more than the budget
+        this->evictTo(fBudget - size);
+        fFree.push_back({p, size});
+        fPooledBytes += size;
+        return true;
+    }
+
+    void setBudget(size_t bytes) {
+        std::lock_guard<std::mutex> lock(fMutex);
+        fBudget = bytes;
+        this->evictTo(bytes);
+    }
+
+    GBitmap::PixelPoolStats stats() {
+        std::lock_guard<std::mutex> lock(fMutex);
+        return { fLive.size(), fFree.size(), fPooledBytes, fBudget };
+    }
+
+    static constexpr size_t kAlign = 64;
+
+private:
+    // drop the least recently released buffers until at most bytes are pooled
+    void evictTo(size_t bytes) {
+        size_t count = 0;
+        while (count < fFree.size() && fPooledBytes > bytes) {
+            fPooledBytes -= fFree[count].size;
+            free(fFree[count].ptr);
+            count += 1;
+        }
+        fFree.erase(fFree.begin(), fFree.begin() + count);
+    }
+
+    struct Entry {
+        void*  ptr;
+        size_t size;
+    };
+    std::mutex fMutex;
+    std::vector<Entry> fFree;                   // oldest first
+    std::unordered_map<void*, size_t> fLive;    // handed out by acquire, with size class
+    size_t fPooledBytes = 0;
+    size_t fBudget = 256 << 20;
+};
+}
+
+size_t GBitmap::DefaultRowBytes(int w) {
+    size_t align = PixelPool::kAlign;
+    size_t rb = (w * sizeof(GPixel) + align - 1) & ~(align - 1);
+    // rows a multiple of 1K apart land on the same few cache sets, so vertical walks
+    // (and tiles) keep evicting each other; one extra cache line breaks the pattern
+    if (rb % 1024 == 0) {
+        rb += align;
+    }
+    return rb;
+}
+
 void GBitmap::alloc(int w, int h, size_t rb) {
     assert(w >= 0);
     assert(h >= 0);
     if (rb == 0) {
-        rb = w * sizeof(GPixel);
+        rb = DefaultRowBytes(w);
     }
     fWidth = w;
     fHeight = h;
     fRowBytes = rb;
 
     this->reset(w, h, rb,
-                (w > 0 && h > 0) ? (GPixel*)calloc(h, rb) : nullptr,
+                (w > 0 && h > 0) ? (GPixel*)PixelPool::Get().acquire(h * rb) : nullptr,
                 kNo_IsOpaque);
 }
+
+void GBitmap::SetPixelPoolBudget(size_t bytes) {
+    PixelPool::Get().setBudget(bytes);
+}
+
+GBitmap::PixelPoolStats GBitmap::GetPixelPoolStats() {
+    return PixelPool::Get().stats();
+}
+
+void GBitmap::release() {
+    if (fPixels) {
+        PixelPool::Get().release(fPixels);
+    }
+    this->reset();
+}
@@ -48,13 +48,8 @@ std::shared_ptr<GPath> GPathBuilder::detach() {
 
 /////////////////////////////////////////////////////////////
 
-static bool is_identity(const GMatrix& m) {
-    return m[0] == 1 && m[3] == 1 &&
-           m[1] == 0 && m[2] == 0 && m[4] == 0 && m[5] == 0;
-}
-
 std::shared_ptr<GPath> GPath::transform(const GMatrix& m) const {
-    if (fPts.empty() || is_identity(m)) {
+    if (fPts.empty() || m.isIdentity()) {
         return const_cast<GPath*>(this)->shared_from_this();
     }
     std::vector<GPoint> dst(fPts.size());
@@ -791,6 +791,19 @@ unsigned lodepng_deflate(unsigned char** out, size_t* outsize,
                          const unsigned char* in, size_t insize,
                          const LodePNGCompressSettings* settings);
 
+/*
+Like lodepng_deflate, but for one part of a stream compressed in pieces. Unless final_part is set, the
+last block is not marked final and is followed by an empty stored block (a "sync flush"), so the output
+ends on a byte boundary and the next part can simply be appended. Each part is compressed on its own:
+matches never reach back into earlier parts.
+*/
+unsigned lodepng_deflate_part(unsigned char** out, size_t* outsize,
+                              const unsigned char* in, size_t insize,
+                              const LodePNGCompressSettings* settings, unsigned final_part);
+
+/*Continue an adler32 checksum (start with 1) over len more bytes, as used by the zlib trailer.*/
+unsigned lodepng_update_adler32(unsigned adler, const unsigned char* data, size_t len);
+
 #endif /*LODEPNG_COMPILE_ENCODER*/
 #endif /*LODEPNG_COMPILE_ZLIB*/
 